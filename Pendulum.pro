@@ -33,8 +33,13 @@ HEADERS  += \
     ode.hpp \
     interface.hpp \
     central_widget.hpp \
+    ensemble.hpp \
+    eventcount.hpp \
     canvas.hpp \
     buffer.hpp \
+    trajectory.hpp \
+    block_tridiagonal.hpp \
+    symmetric_tridiagonal.hpp \
     application.hpp \
     math/vector4.hpp \
     math/vector3.hpp \
@@ -0,0 +1,58 @@
+#-------------------------------------------------
+#
+# Batch simulation without the GUI, see README.md.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = PendulumHeadless
+TEMPLATE = app
+
+# The sweep runs the lanes of its ensembles in vector registers, if the loops
+# over them are vectorized, which GCC does not do at -O2 on its own. Build
+# with CONFIG+=avx2 for machines with AVX2 and FMA, for wider registers.
+*-g++* {
+    QMAKE_CXXFLAGS_RELEASE += -ftree-vectorize -fvect-cost-model=dynamic
+}
+avx2 {
+    *-g++*|*-clang*: QMAKE_CXXFLAGS += -mavx2 -mfma
+    *-msvc*: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
+
+SOURCES += \
+    sweep.cpp \
+    scenario.cpp \
+    pendulum.cpp \
+    headless.cpp
+
+HEADERS  += \
+    sweep.hpp \
+    spawner.hpp \
+    ensemble.hpp \
+    scenario.hpp \
+    queue.hpp \
+    pendulum.hpp \
+    ode.hpp \
+    eventcount.hpp \
+    buffer.hpp \
+    trajectory.hpp \
+    block_tridiagonal.hpp \
+    symmetric_tridiagonal.hpp \
+    math/vector4.hpp \
+    math/vector3.hpp \
+    math/vector2.hpp \
+    math/vector.hpp \
+    math/tabproxy.hpp \
+    math/quaternion.hpp \
+    math/matrix4.hpp \
+    math/matrix3.hpp \
+    math/matrix2.hpp \
+    math/matrix.hpp \
+    math/matrix_prefix.hpp \
+    math/math.hpp
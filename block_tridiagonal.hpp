@@ -0,0 +1,217 @@
+#ifndef JG_BLOCK_TRIDIAGONAL_HPP
+#define JG_BLOCK_TRIDIAGONAL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace jg {
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                            BlockTridiagonal                                **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Square matrix over a state of 2m components, m positions followed by the
+// m matching velocities, in which node k (position k and velocity k) is
+// coupled only to nodes k - 1, k and k + 1. It is stored as m rows of three
+// 2x2 blocks, so it takes O(m) memory and linear systems with it are solved
+// in O(m) by block Gaussian elimination without pivoting. That is stable for
+// the matrices I - gamma * J met by implicit integrators, which are block
+// diagonally dominant for small enough gamma.
+template <typename T>
+class BlockTridiagonal
+{
+public:
+    explicit BlockTridiagonal(size_t nodeCnt = 0);
+
+    size_t      nodeCnt() const;
+    size_t      size() const;
+    void        resize(size_t nodeCnt);
+    void        setZero();
+    T&          operator () (size_t i, size_t j);
+    T           operator () (size_t i, size_t j) const;
+    bool        inBand(size_t i, size_t j) const;
+    void        shiftedScale(T s);
+    void        factor();
+    void        solve(T* b) const;
+
+private:
+    size_t          m;
+    // Blocks of node row k are at 4 * k, entry (r, c) at 4 * k + 2 * r + c.
+    std::vector<T>  lower;
+    std::vector<T>  diag;
+    std::vector<T>  upper;
+    bool            factored;
+
+    std::vector<T>& band(size_t ki, size_t kj);
+};
+
+template <typename T> inline
+BlockTridiagonal<T>::BlockTridiagonal(size_t nodeCnt)
+:   m(nodeCnt),
+    lower(4 * nodeCnt, 0),
+    diag(4 * nodeCnt, 0),
+    upper(4 * nodeCnt, 0),
+    factored(false)
+{/* Do nothing. */}
+
+template <typename T> inline size_t
+BlockTridiagonal<T>::nodeCnt() const { return m; }
+
+template <typename T> inline size_t
+BlockTridiagonal<T>::size() const { return 2 * m; }
+
+template <typename T>
+inline void
+BlockTridiagonal<T>::resize(size_t nodeCnt)
+{
+    m = nodeCnt;
+    lower.resize(4 * m);
+    diag.resize(4 * m);
+    upper.resize(4 * m);
+    setZero();
+}
+
+template <typename T>
+inline void
+BlockTridiagonal<T>::setZero()
+{
+    std::fill(lower.begin(), lower.end(), static_cast<T>(0));
+    std::fill(diag.begin(), diag.end(), static_cast<T>(0));
+    std::fill(upper.begin(), upper.end(), static_cast<T>(0));
+    factored = false;
+}
+
+template <typename T>
+inline bool
+BlockTridiagonal<T>::inBand(size_t i, size_t j) const
+{
+    size_t const ki = i % m;
+    size_t const kj = j % m;
+    return ki <= kj + 1 && kj <= ki + 1;
+}
+
+template <typename T>
+inline std::vector<T>&
+BlockTridiagonal<T>::band(size_t ki, size_t kj)
+{
+    return kj < ki ? lower : (kj == ki ? diag : upper);
+}
+
+template <typename T>
+inline T&
+BlockTridiagonal<T>::operator () (size_t i, size_t j)
+{
+    if (i >= size() || j >= size() || !inBand(i, j))
+        throw std::out_of_range("BlockTridiagonal::operator (): Entry \
+outside of the band.");
+    size_t const ki = i % m;
+    return band(ki, j % m)[4 * ki + 2 * (i / m) + j / m];
+}
+
+template <typename T>
+inline T
+BlockTridiagonal<T>::operator () (size_t i, size_t j) const
+{
+    if (i >= size() || j >= size() || !inBand(i, j)) return 0;
+    size_t const ki = i % m;
+    size_t const kj = j % m;
+    std::vector<T> const& b = kj < ki ? lower : (kj == ki ? diag : upper);
+    return b[4 * ki + 2 * (i / m) + j / m];
+}
+
+// Replaces the matrix A with I + s * A.
+template <typename T>
+inline void
+BlockTridiagonal<T>::shiftedScale(T s)
+{
+    for (size_t i = 0; i < 4 * m; ++i)
+    {
+        lower[i]    *= s;
+        diag[i]     *= s;
+        upper[i]    *= s;
+    }
+    for (size_t k = 0; k < m; ++k)
+    {
+        diag[4 * k]     += 1;
+        diag[4 * k + 3] += 1;
+    }
+    factored = false;
+}
+
+// Factors the matrix in place. Afterwards lower holds the elimination
+// multipliers and diag the inverses of the pivot blocks.
+template <typename T>
+void
+BlockTridiagonal<T>::factor()
+{
+    for (size_t k = 0; k < m; ++k)
+    {
+        T* const d = &diag[4 * k];
+        if (k > 0)
+        {
+            // l = l * inv(D[k - 1]), D[k] -= l * U[k - 1].
+            T* const        l   = &lower[4 * k];
+            T const* const  di  = &diag[4 * (k - 1)];
+            T const* const  u   = &upper[4 * (k - 1)];
+            T const l0 = l[0] * di[0] + l[1] * di[2];
+            T const l1 = l[0] * di[1] + l[1] * di[3];
+            T const l2 = l[2] * di[0] + l[3] * di[2];
+            T const l3 = l[2] * di[1] + l[3] * di[3];
+            l[0] = l0; l[1] = l1; l[2] = l2; l[3] = l3;
+            d[0] -= l0 * u[0] + l1 * u[2];
+            d[1] -= l0 * u[1] + l1 * u[3];
+            d[2] -= l2 * u[0] + l3 * u[2];
+            d[3] -= l2 * u[1] + l3 * u[3];
+        }
+        T const det = d[0] * d[3] - d[1] * d[2];
+        if (det == 0)
+            throw std::runtime_error("BlockTridiagonal::factor(): Singular \
+pivot block.");
+        T const d0 = d[0];
+        d[0] =  d[3] / det;
+        d[1] = -d[1] / det;
+        d[2] = -d[2] / det;
+        d[3] =  d0   / det;
+    }
+    factored = true;
+}
+
+// Solves A x = b for a factored A, overwriting b with x.
+template <typename T>
+void
+BlockTridiagonal<T>::solve(T* b) const
+{
+    if (!factored)
+        throw std::logic_error("BlockTridiagonal::solve(): Matrix is not \
+factored.");
+    for (size_t k = 1; k < m; ++k)
+    {
+        T const* const l = &lower[4 * k];
+        b[k]        -= l[0] * b[k - 1] + l[1] * b[m + k - 1];
+        b[m + k]    -= l[2] * b[k - 1] + l[3] * b[m + k - 1];
+    }
+    for (size_t k = m; k-- > 0;)
+    {
+        T r0 = b[k];
+        T r1 = b[m + k];
+        if (k + 1 < m)
+        {
+            T const* const u = &upper[4 * k];
+            r0 -= u[0] * b[k + 1] + u[1] * b[m + k + 1];
+            r1 -= u[2] * b[k + 1] + u[3] * b[m + k + 1];
+        }
+        T const* const di = &diag[4 * k];
+        b[k]        = di[0] * r0 + di[1] * r1;
+        b[m + k]    = di[2] * r0 + di[3] * r1;
+    }
+}
+
+} // namespace jg
+
+#endif // JG_BLOCK_TRIDIAGONAL_HPP
@@ -1,14 +1,32 @@
 #ifndef JG_BUFFER_HPP
 #define JG_BUFFER_HPP
 
+#include <atomic>
+
 #include <QtCore/QtCore>
 
+#include "eventcount.hpp"
 #include "queue.hpp"
 #include "spawner.hpp"
 
 namespace jg {
 
-template <typename T>
+// Fills a queue from its own thread, with items produced by the spawner, for
+// a single consumer thread to take. The queue is lock-free and either side
+// sleeps on an event count only when it has to wait for the other, so in the
+// steady state a handed over item costs no lock and no wake-up. The spawner
+// and the capacity cannot be changed while the buffer is running.
+//
+// The producer thread is started once and lives as long as the buffer.
+// stop() only ends the current generation: it bumps the epoch, waits for the
+// producer to drop whatever item it was spawning and go idle, and empties the
+// queue in one step. The next startBuffering() just wakes the thread up.
+//
+// The container Q is a Queue of T by default. Any single-producer
+// single-consumer ring with the same interface will do, like a Trajectory,
+// whose items are views of type Q::Reference filled in place by the spawner;
+// next() and nextInto() are then unavailable.
+template <typename T, typename Q = Queue<T> >
 class Buffer : public QThread
 {
 public:
@@ -24,9 +42,8 @@ public:
     bool        empty() const;
     bool        full();
     T           next();
+    void        nextInto(T& item);
     void        pop();
-    T const&    peek();
-    T const&    peekLast();
     bool        buffering() const;
     bool        running() const;
     void        setSpawner(Spawner<T>* spawner);
@@ -34,227 +51,305 @@ public:
     void        startBuffering(Spawner<T>* spawner);
     void        pause();
     void        stop();
+    void        notifyProducer();
+    bool        waitForSize(size_t size, unsigned long time);
+    Q&          container();
+    Q const&    container() const;
+
+    typename Q::ConstReference  peek(size_t i = 0);
+    typename Q::ConstReference  peekLast();
 
 private:
-    Spawner<T>*     m_spawner;
-    Queue<T>        m_queue;
-    bool            m_buffering;
-    bool            m_running;
-    QMutex          m_queueMutex;
-    QMutex          m_spawnerMutex;
-    QMutex          m_bufferingMutex;
-    QWaitCondition  m_bufferingWaitCondition;
-    QWaitCondition  m_queueWaitCondition;
-
-    void waitWhileEmpty();
-    void waitWhileFullAndBuffering();
-    void waitWhileNotBuffering();
+    Spawner<T>*         m_spawner;
+    Q                   m_queue;
+    std::atomic<bool>   m_buffering;
+    std::atomic<bool>   m_running;
+    std::atomic<bool>   m_exiting;
+    // Bumped by every stop(); the producer confirms that it has seen the
+    // stop by copying it to m_stoppedEpoch.
+    std::atomic<unsigned int>   m_epoch;
+    std::atomic<unsigned int>   m_stoppedEpoch;
+    EventCount          m_consumerEvent;
+    EventCount          m_producerEvent;
+
+    void waitForSize(size_t size);
+    void waitForProducerStop(unsigned int epoch);
+    bool producerMustWait(unsigned int epoch) const;
     void run();
 };
 
-template <typename T> inline
-Buffer<T>::Buffer(
+template <typename T, typename Q> inline
+Buffer<T, Q>::Buffer(
     Spawner<T>* spawner,
     size_t      capacity
 )
 :   m_spawner(spawner),
     m_queue(capacity),
     m_buffering(false),
-    m_running(false)
+    m_running(false),
+    m_exiting(false),
+    m_epoch(0),
+    m_stoppedEpoch(0)
 {/* Do nothing. */}
 
-template <typename T> inline
-Buffer<T>::Buffer(size_t capacity)
+template <typename T, typename Q> inline
+Buffer<T, Q>::Buffer(size_t capacity)
 :   Buffer(NULL, capacity)
 {/* Do nothing. */}
 
-template <typename T> inline
-Buffer<T>::~Buffer()
+template <typename T, typename Q> inline
+Buffer<T, Q>::~Buffer()
 {
-    stop();
+    m_exiting = true;
+    m_running = false;
+    m_buffering = false;
+    m_producerEvent.notify();
+    m_consumerEvent.notify();
+    wait();
 }
 
-template <typename T> inline size_t
-Buffer<T>::capacity() const { return m_queue.capacity(); }
+template <typename T, typename Q> inline size_t
+Buffer<T, Q>::capacity() const { return m_queue.capacity(); }
 
-template <typename T>
+template <typename T, typename Q>
 inline void
-Buffer<T>::setCapacity(size_t capacity)
+Buffer<T, Q>::setCapacity(size_t capacity)
 {
-    m_queueMutex.lock();
-        m_queue.setCapacity(capacity);
-    m_queueMutex.unlock();
+    if (running())
+        throw std::runtime_error("Buffer::setCapacity(): Cannot change the \
+capacity while running.");
+    m_queue.setCapacity(capacity);
 }
 
-template <typename T> inline size_t
-Buffer<T>::size() const {return m_queue.size(); }
+template <typename T, typename Q> inline size_t
+Buffer<T, Q>::size() const {return m_queue.size(); }
 
-template <typename T> inline bool
-Buffer<T>::empty() const { return m_queue.empty(); }
+template <typename T, typename Q> inline bool
+Buffer<T, Q>::empty() const { return m_queue.empty(); }
 
-template <typename T>
-inline bool
-Buffer<T>::full()
-{
-    m_queueMutex.lock();
-        bool b = m_queue.full();
-    m_queueMutex.unlock();
-    return b;
-}
+template <typename T, typename Q> inline bool
+Buffer<T, Q>::full() { return m_queue.size() >= m_queue.capacity(); }
 
-template <typename T>
+template <typename T, typename Q>
 inline T
-Buffer<T>::next()
+Buffer<T, Q>::next()
 {
-    T const n = peek();
-    pop();
+    T n = T();
+    nextInto(n);
     return n;
 }
 
-template <typename T>
+// Takes the next item by swapping it with item, whose former contents are
+// left in the queue for the producer to reuse.
+template <typename T, typename Q>
 inline void
-Buffer<T>::pop()
+Buffer<T, Q>::nextInto(T& item)
 {
-    waitWhileEmpty();
-    m_queueMutex.lock();
-        m_queue.pop();
-    m_queueMutex.unlock();
-    m_queueWaitCondition.wakeAll();
+    waitForSize(1);
+    m_queue.popInto(item);
+    m_producerEvent.notify();
 }
 
-template <typename T>
-inline T const&
-Buffer<T>::peek()
+template <typename T, typename Q>
+inline void
+Buffer<T, Q>::pop()
 {
-    waitWhileEmpty();
-    return m_queue.front();
+    waitForSize(1);
+    m_queue.pop();
+    m_producerEvent.notify();
 }
 
-template <typename T>
-inline T const&
-Buffer<T>::peekLast()
+// Item i places behind the front, waiting for it if necessary.
+template <typename T, typename Q>
+inline typename Q::ConstReference
+Buffer<T, Q>::peek(size_t i)
 {
-    waitWhileEmpty();
-    m_queueMutex.lock();
-        T const& n = m_queue.back();
-    m_queueMutex.unlock();
-    return n;
+    waitForSize(i + 1);
+    return m_queue.at(i);
 }
 
-template <typename T> inline bool
-Buffer<T>::buffering() const { return m_buffering; }
+template <typename T, typename Q>
+inline typename Q::ConstReference
+Buffer<T, Q>::peekLast()
+{
+    waitForSize(1);
+    return m_queue.back();
+}
+
+template <typename T, typename Q> inline bool
+Buffer<T, Q>::buffering() const { return m_buffering; }
 
-template <typename T> inline bool
-Buffer<T>::running() const { return m_running; }
+template <typename T, typename Q> inline bool
+Buffer<T, Q>::running() const { return m_running; }
 
-template <typename T>
+template <typename T, typename Q>
 inline void
-Buffer<T>::setSpawner(Spawner<T>* spawner)
+Buffer<T, Q>::setSpawner(Spawner<T>* spawner)
 {
-    m_spawnerMutex.lock();
-        m_spawner = spawner;
-    m_spawnerMutex.unlock();;
+    if (running())
+        throw std::runtime_error("Buffer::setSpawner(): Cannot change the \
+spawner while running.");
+    m_spawner = spawner;
 }
 
-template <typename T>
+template <typename T, typename Q>
 inline void
-Buffer<T>::startBuffering()
+Buffer<T, Q>::startBuffering()
 {
     if (m_spawner == NULL) throw std::runtime_error("Buffer::startBuffering(): \
 Cannot start buffering withount a spawner.");
     if (!running())
     {
         m_running = true;
-        start();
+        if (isRunning()) m_producerEvent.notify();
+        else start();
     }
     if (!buffering())
     {
-        m_bufferingMutex.lock();
-            m_buffering = true;
-            m_bufferingWaitCondition.wakeAll();
-        m_bufferingMutex.unlock();
+        m_buffering = true;
+        m_producerEvent.notify();
     }
 }
 
-template <typename T>
+template <typename T, typename Q>
 inline void
-Buffer<T>::startBuffering(Spawner<T>* spawner)
+Buffer<T, Q>::startBuffering(Spawner<T>* spawner)
 {
     setSpawner(spawner);
     startBuffering();
 }
 
-template <typename T>
+template <typename T, typename Q>
 inline void
-Buffer<T>::pause()
+Buffer<T, Q>::pause()
 {   
-    m_bufferingMutex.lock();
-        m_buffering = false;
-    m_bufferingMutex.unlock();
-    m_queueWaitCondition.wakeAll(); // Wake if waiting while full and buffering.
+    m_buffering = false;
+    m_producerEvent.notify();
+    m_consumerEvent.notify();
 }
 
-template <typename T>
+template <typename T, typename Q>
 inline void
-Buffer<T>::stop()
+Buffer<T, Q>::stop()
 {   
+    unsigned int const epoch = m_epoch.fetch_add(1) + 1;
     m_running = false;
-    m_bufferingWaitCondition.wakeAll();
-    m_queueWaitCondition.wakeAll();
-    wait();
     m_buffering = false;
+    m_producerEvent.notify();
+    m_consumerEvent.notify();
+    if (isRunning()) waitForProducerStop(epoch);
     m_queue.clear();
 }
 
-template <typename T>
+// Wakes the producer if it waits for room in a container that has readers
+// besides the consumer, after one of them has moved on.
+template <typename T, typename Q>
 inline void
-Buffer<T>::waitWhileEmpty()
+Buffer<T, Q>::notifyProducer()
 {
-    m_queueMutex.lock();
-        while (empty() && buffering()) m_queueWaitCondition.wait(&m_queueMutex);
-        if (!buffering())
-                throw std::runtime_error("Buffer::waitWhileEmpty(): Not \
-buffering. Waiting while the buffer is empty leads to a deadlock.");
-    m_queueMutex.unlock();
+    m_producerEvent.notify();
+}
+
+// The container may only be reconfigured while the buffer is not running.
+template <typename T, typename Q>
+inline Q&
+Buffer<T, Q>::container()
+{
+    return m_queue;
 }
 
-template <typename T>
+template <typename T, typename Q>
+inline Q const&
+Buffer<T, Q>::container() const
+{
+    return m_queue;
+}
+
+template <typename T, typename Q>
 inline void
-Buffer<T>::waitWhileFullAndBuffering()
+Buffer<T, Q>::waitForSize(size_t size)
 {
-    m_queueMutex.lock();
-        if (m_queue.full() && buffering())
-            m_queueWaitCondition.wait(&m_queueMutex);
-    m_queueMutex.unlock();
+    while (m_queue.size() < size)
+    {
+        if (!buffering())
+            throw std::runtime_error("Buffer::waitForSize(): Not buffering. \
+Waiting for items that will not come leads to a deadlock.");
+        EventCount::Key const key = m_consumerEvent.prepareWait();
+        if (m_queue.size() >= size || !buffering())
+            m_consumerEvent.cancelWait();
+        else m_consumerEvent.wait(key);
+    }
 }
 
-template <typename T>
+// Like the blocking variant, but gives up after time milliseconds, or at
+// once when not buffering. Returns whether the queue holds size items.
+template <typename T, typename Q>
+bool
+Buffer<T, Q>::waitForSize(size_t size, unsigned long time)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (m_queue.size() < size)
+    {
+        qint64 const elapsed = timer.elapsed();
+        if (!buffering() || elapsed >= static_cast<qint64>(time)) return false;
+        EventCount::Key const key = m_consumerEvent.prepareWait();
+        if (m_queue.size() >= size || !buffering())
+            m_consumerEvent.cancelWait();
+        else m_consumerEvent.wait(key, time - elapsed);
+    }
+    return true;
+}
+
+// Once it returns, the producer leaves the queue and the spawner alone until
+// the buffer is started again.
+template <typename T, typename Q>
 inline void
-Buffer<T>::waitWhileNotBuffering()
+Buffer<T, Q>::waitForProducerStop(unsigned int epoch)
 {
-    m_bufferingMutex.lock();
-        if (!buffering()) m_bufferingWaitCondition.wait(&m_bufferingMutex);
-    m_bufferingMutex.unlock();
+    while (m_stoppedEpoch.load() != epoch)
+    {
+        EventCount::Key const key = m_consumerEvent.prepareWait();
+        if (m_stoppedEpoch.load() == epoch) m_consumerEvent.cancelWait();
+        else m_consumerEvent.wait(key);
+    }
 }
 
-template <typename T>
+template <typename T, typename Q>
+inline bool
+Buffer<T, Q>::producerMustWait(unsigned int epoch) const
+{
+    return !m_exiting && m_epoch.load() == epoch
+        && (!running() || !buffering() || m_queue.full());
+}
+
+template <typename T, typename Q>
 void
-Buffer<T>::run()
+Buffer<T, Q>::run()
 {
-    while (running())
+    while (!m_exiting)
     {
-        waitWhileNotBuffering();
-        waitWhileFullAndBuffering();    
-        if(buffering() && !full())
+        unsigned int const epoch = m_epoch.load();
+        if (!running() && m_stoppedEpoch.load() != epoch)
+        {
+            m_stoppedEpoch.store(epoch);
+            m_consumerEvent.notify();
+        }
+        if (producerMustWait(epoch))
         {
-            m_spawnerMutex.lock();
-                T const n = m_spawner->spawn();
-            m_spawnerMutex.unlock();
-            m_queueMutex.lock();
-                m_queue.push(n);
-            m_queueMutex.unlock();
-            m_queueWaitCondition.wakeAll();
+            EventCount::Key const key = m_producerEvent.prepareWait();
+            if (producerMustWait(epoch)) m_producerEvent.wait(key);
+            else m_producerEvent.cancelWait();
+            continue;
         }
+        if (!running()) continue;
+        typename Q::Reference item = m_queue.beginPush();
+        m_spawner->spawnInto(item);
+        // An item spawned across a stop() belongs to the old generation and
+        // is dropped by simply not publishing it.
+        if (m_epoch.load() != epoch) continue;
+        m_queue.endPush();
+        m_consumerEvent.notify();
     }
 }
 
@@ -13,6 +13,8 @@ float const         Canvas::RADIUS_FACTOR       = 1.1f;
 float const         Canvas::CROSS_FACTOR        = 0.3f;
 float const         Canvas::LENGTH_FACTOR       = 0.1f;
 uint const          Canvas::CIRCLE_SIDES        = 16;
+float const         Canvas::OUTPUT_INTERVAL     = 0.004f;
+unsigned long const Canvas::EVAL_TIMEOUT        = 5;
 math::float3 const  Canvas::ANCHOR_COLOR        = math::float3(0.0f, 0.0f, 0.0f);
 math::float3 const  Canvas::SEGMENT_COLOR       = math::float3(0.2f, 0.2f, 0.2f);
 math::float3 const  Canvas::WEIGHT_COLOR        = math::float3(0.2f, 0.3f, 0.8f);
@@ -21,14 +23,21 @@ math::float3 const  Canvas::SECOND_NEG_COLOR    = math::float3(0.0f, 0.0f, 0.0f)
 math::float3 const  Canvas::HOVER_COLOR         = math::float3(1.0f, 1.0f, 1.0f);
 math::float3 const  Canvas::HOLD_COLOR          = math::float3(1.0f, 0.0f, 0.0f);
 math::float3 const  Canvas::CROSS_COLOR         = math::float3(1.0f, 0.0f, 0.0f);
+math::float3 const  Canvas::BUFFERED_COLOR      = math::float3(0.2f, 0.3f, 0.8f);
+math::float3 const  Canvas::LAG_COLOR           = math::float3(0.9f, 0.1f, 0.1f);
 
 Canvas::Canvas(int fps, QWidget* parent)
 :   QGLWidget(parent),
+    modeCnt(0),
+    reduced(false),
     step(1e-4),
     holding(0),
     hovering(0),
     updater(this),
-    canvasHeight(HEIGHT + 2 * MARGIN)
+    canvasHeight(HEIGHT + 2 * MARGIN),
+    elapsedTime(0),
+    bufferedTime(0),
+    lagTime(0)
 {
     setMouseTracking(true);
     repaintTimer.setInterval(1000 / fps);
@@ -124,14 +133,26 @@ Canvas::start()
         if(running()) stop();
 
         pendulum = referencePendulum;
+        // The modes are those of the pendulum as started, rendering
+        // reconstructs its nodes from them.
+        reduced = modeCnt > 0
+            && static_cast<size_t>(modeCnt) < pendulum.segmentCnt();
+        if (reduced) modes = PendulumModes(pendulum.segmentCnt(), modeCnt);
         switch (precision)
         {
         case FLOAT: {
             std::vector<float> y(pendulum.weightCnt() * 2, 0);
             for (int i = 0; i < pendulum.weightCnt(); ++i)
                 y[i] = pendulum.deflection(i);
+            if (reduced)
+            {
+                std::vector<float> z(2 * (modeCnt + 1));
+                modes.project(&y[0], &z[0]);
+                y.swap(z);
+            }
             solutionFloat.setInitialCondition(0, y);
-            solutionFloat.setEquation(new PendulumODEFun<float>(
+            solutionFloat.setOutputInterval(OUTPUT_INTERVAL);
+            PendulumODEFun<float> const f(
                 pendulum.length(),
                 pendulum.mass(),
                 pendulum.radius(),
@@ -139,14 +160,35 @@ Canvas::start()
                 amplitude,
                 viscosity,
                 density
-            ));
+            );
+            solutionFloat.setEquation(reduced ? newPendulumODEFun(f, modes)
+                : newPendulumODEFun(f, pendulum.segmentCnt()));
             switch (integrator)
             {
             case EULER:
                 solutionFloat.setIntegrator(new EulerIntegrator<float>(step));
                 break;
             case RK4:
-                solutionFloat.setIntegrator(new RK4Integrator<float>(step));
+                solutionFloat.setIntegrator(newRK4Integrator<float>(
+                    reduced ? modes.modeCnt() : pendulum.segmentCnt(), step));
+                break;
+            case DORMAND_PRINCE:
+                solutionFloat.setIntegrator(
+                    new DormandPrinceIntegrator<float>(step));
+                break;
+            case VERLET:
+                solutionFloat.setIntegrator(new VerletIntegrator<float>(step));
+                break;
+            case FOREST_RUTH:
+                solutionFloat.setIntegrator(
+                    new ForestRuthIntegrator<float>(step));
+                break;
+            case ROSENBROCK:
+                solutionFloat.setIntegrator(
+                    new RosenbrockIntegrator<float>(step));
+                break;
+            case MODAL:
+                solutionFloat.setIntegrator(new ModalIntegrator<float>(step));
                 break;
             }
             solutionFloat.start();
@@ -156,8 +198,15 @@ Canvas::start()
             std::vector<double> y(pendulum.weightCnt() * 2, 0);
             for (int i = 0; i < pendulum.weightCnt(); ++i)
                 y[i] = pendulum.deflection(i);
+            if (reduced)
+            {
+                std::vector<double> z(2 * (modeCnt + 1));
+                modes.project(&y[0], &z[0]);
+                y.swap(z);
+            }
             solutionDouble.setInitialCondition(0, y);
-            solutionDouble.setEquation(new PendulumODEFun<double>(
+            solutionDouble.setOutputInterval(OUTPUT_INTERVAL);
+            PendulumODEFun<double> const f(
                 pendulum.length(),
                 pendulum.mass(),
                 pendulum.radius(),
@@ -165,14 +214,35 @@ Canvas::start()
                 amplitude,
                 viscosity,
                 density
-            ));
+            );
+            solutionDouble.setEquation(reduced ? newPendulumODEFun(f, modes)
+                : newPendulumODEFun(f, pendulum.segmentCnt()));
             switch (integrator)
             {
             case EULER:
                 solutionDouble.setIntegrator(new EulerIntegrator<double>(step));
                 break;
             case RK4:
-                solutionDouble.setIntegrator(new RK4Integrator<double>(step));
+                solutionDouble.setIntegrator(newRK4Integrator<double>(
+                    reduced ? modes.modeCnt() : pendulum.segmentCnt(), step));
+                break;
+            case DORMAND_PRINCE:
+                solutionDouble.setIntegrator(
+                    new DormandPrinceIntegrator<double>(step));
+                break;
+            case VERLET:
+                solutionDouble.setIntegrator(new VerletIntegrator<double>(step));
+                break;
+            case FOREST_RUTH:
+                solutionDouble.setIntegrator(
+                    new ForestRuthIntegrator<double>(step));
+                break;
+            case ROSENBROCK:
+                solutionDouble.setIntegrator(
+                    new RosenbrockIntegrator<double>(step));
+                break;
+            case MODAL:
+                solutionDouble.setIntegrator(new ModalIntegrator<double>(step));
                 break;
             }
             solutionDouble.start();
@@ -213,11 +283,20 @@ Canvas::update()
     {
         Pendulum newPendulum = referencePendulum;
         float t = static_cast<float>(timer.elapsed() - refTime) / 1000.0f;
-        ODE<float>::Y y = solutionFloat(t);
+        ODE<float>::Y y;
+        float const lag = solutionFloat.tryEval(t, y, EVAL_TIMEOUT);
+        if (reduced)
+        {
+            ODE<float>::Y nodes(2 * newPendulum.weightCnt());
+            modes.reconstruct(&y[0], &nodes[0]);
+            y.swap(nodes);
+        }
         for (int i = 0; i < newPendulum.weightCnt(); ++i)
             newPendulum.setDeflection(i, y[i]);
         timeMutex.lock();
-            elapsedTime = t;
+            elapsedTime = t - lag;
+            bufferedTime = solutionFloat.bufferedTime();
+            lagTime = lag;
         timeMutex.unlock();
         pendulumMutex.lock();
             pendulum = newPendulum;
@@ -227,11 +306,20 @@ Canvas::update()
     {
         Pendulum newPendulum = referencePendulum;
         double t = static_cast<double>(timer.elapsed() - refTime) / 1000.0;
-        ODE<double>::Y y = solutionDouble(t);
+        ODE<double>::Y y;
+        double const lag = solutionDouble.tryEval(t, y, EVAL_TIMEOUT);
+        if (reduced)
+        {
+            ODE<double>::Y nodes(2 * newPendulum.weightCnt());
+            modes.reconstruct(&y[0], &nodes[0]);
+            y.swap(nodes);
+        }
         for (int i = 0; i < newPendulum.weightCnt(); ++i)
             newPendulum.setDeflection(i, y[i]);
         timeMutex.lock();
-            elapsedTime = t;
+            elapsedTime = static_cast<float>(t - lag);
+            bufferedTime = static_cast<float>(solutionDouble.bufferedTime());
+            lagTime = static_cast<float>(lag);
         timeMutex.unlock();
         pendulumMutex.lock();
             pendulum = newPendulum;
@@ -246,6 +334,7 @@ void Canvas::setSegmentCnt(int value)
     scale = HEIGHT / referencePendulum.totalLength();
     referencePositions = referencePendulum.positions();
 }
+void Canvas::setModeCnt(int value) { modeCnt = value; }
 void Canvas::setSegmentLength(float value)
 {
     referencePendulum.setLength(value);
@@ -254,16 +343,62 @@ void Canvas::setSegmentLength(float value)
 }
 void Canvas::setNodeMass(float value) { referencePendulum.setMass(value); }
 void Canvas::setNodeRadius(float value) { referencePendulum.setRadius(value); }
-void Canvas::setAmplitude(float value) { amplitude = value; }
-void Canvas::setAngFrequency(float value) { angFrequency = value; }
-void Canvas::setViscosity(float value) { viscosity = value; }
-void Canvas::setDensity(float value) { density = value; }
+void Canvas::setAmplitude(float value) { amplitude = value; updateEquation(); }
+void Canvas::setAngFrequency(float value)
+{
+    angFrequency = value;
+    updateEquation();
+}
+void Canvas::setViscosity(float value) { viscosity = value; updateEquation(); }
+void Canvas::setDensity(float value) { density = value; updateEquation(); }
+
+// Hands the driver and fluid properties to the running solution, which
+// carries on from the time last shown under the new equation.
+void
+Canvas::updateEquation()
+{
+    flowMutex.lock();
+    if (solutionFloat.running())
+    {
+        PendulumODEFun<float> const f(
+            pendulum.length(),
+            pendulum.mass(),
+            pendulum.radius(),
+            angFrequency,
+            amplitude,
+            viscosity,
+            density
+        );
+        solutionFloat.setEquation(reduced ? newPendulumODEFun(f, modes)
+            : newPendulumODEFun(f, pendulum.segmentCnt()));
+    }
+    else if (solutionDouble.running())
+    {
+        PendulumODEFun<double> const f(
+            pendulum.length(),
+            pendulum.mass(),
+            pendulum.radius(),
+            angFrequency,
+            amplitude,
+            viscosity,
+            density
+        );
+        solutionDouble.setEquation(reduced ? newPendulumODEFun(f, modes)
+            : newPendulumODEFun(f, pendulum.segmentCnt()));
+    }
+    flowMutex.unlock();
+}
 
 void
 Canvas::setIntegrator(QString const& value)
 {
-    if      (value == "Euler"   ) integrator = EULER;
-    else if (value == "RK4"     ) integrator = RK4;
+    if      (value == "Euler"         ) integrator = EULER;
+    else if (value == "RK4"           ) integrator = RK4;
+    else if (value == "Dormand-Prince") integrator = DORMAND_PRINCE;
+    else if (value == "Verlet"        ) integrator = VERLET;
+    else if (value == "Forest-Ruth"   ) integrator = FOREST_RUTH;
+    else if (value == "Rosenbrock"    ) integrator = ROSENBROCK;
+    else if (value == "Modal"         ) integrator = MODAL;
 }
 
 void
@@ -312,6 +447,8 @@ void Canvas::paintGL()
         pendulumMutex.unlock();
         paintPendulum(paintedPendulum);
         paintTime(elapsedTime);
+        paintBuffered(bufferedTime);
+        paintLag(lagTime);
     }
     else
     {
@@ -387,6 +524,38 @@ Canvas::paintTime(float t)
     glEnd();
 }
 
+// Bar under the time bar, as long as the simulated time computed ahead.
+void
+Canvas::paintBuffered(float t)
+{
+    glLoadIdentity();
+    glTranslatef(-0.5f * canvasWidth, -MARGIN, 0);
+    glColor3fv(BUFFERED_COLOR);
+    glBegin(GL_QUADS);
+        glVertex2f(0, BAR_WIDTH);
+        glVertex2f(t * SECOND_LENGTH, BAR_WIDTH);
+        glVertex2f(t * SECOND_LENGTH, 1.5f * BAR_WIDTH);
+        glVertex2f(0, 1.5f * BAR_WIDTH);
+    glEnd();
+}
+
+// Red bar in place of the buffered one, as long as the displayed state lags
+// behind real time, when the integration cannot keep up.
+void
+Canvas::paintLag(float t)
+{
+    if (t <= 0) return;
+    glLoadIdentity();
+    glTranslatef(-0.5f * canvasWidth, -MARGIN, 0);
+    glColor3fv(LAG_COLOR);
+    glBegin(GL_QUADS);
+        glVertex2f(0, BAR_WIDTH);
+        glVertex2f(t * SECOND_LENGTH, BAR_WIDTH);
+        glVertex2f(t * SECOND_LENGTH, 1.5f * BAR_WIDTH);
+        glVertex2f(0, 1.5f * BAR_WIDTH);
+    glEnd();
+}
+
 void
 Canvas::paintCircle(
     math::float2 const& pos,
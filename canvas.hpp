@@ -46,6 +46,7 @@ public slots:
     void pause();
     void update();
     void setSegmentCnt(int value);
+    void setModeCnt(int value);
     void setSegmentLength(float value);
     void setNodeMass(float value);
     void setNodeRadius(float value);
@@ -60,7 +61,12 @@ public slots:
 private:
     enum Integrator {
         EULER,
-        RK4
+        RK4,
+        DORMAND_PRINCE,
+        VERLET,
+        FOREST_RUTH,
+        ROSENBROCK,
+        MODAL
     };
     enum Precision {
         FLOAT,
@@ -75,6 +81,8 @@ private:
     static float const          CROSS_FACTOR;
     static float const          LENGTH_FACTOR;
     static uint const           CIRCLE_SIDES;
+    static float const          OUTPUT_INTERVAL;
+    static unsigned long const  EVAL_TIMEOUT;
     static math::float3 const   ANCHOR_COLOR;
     static math::float3 const   SEGMENT_COLOR;
     static math::float3 const   WEIGHT_COLOR;
@@ -83,10 +91,15 @@ private:
     static math::float3 const   HOVER_COLOR;
     static math::float3 const   HOLD_COLOR;
     static math::float3 const   CROSS_COLOR;
+    static math::float3 const   BUFFERED_COLOR;
+    static math::float3 const   LAG_COLOR;
 
     Pendulum            referencePendulum;
     Pendulum::PolyChain referencePositions;
     Pendulum            pendulum;
+    int                 modeCnt;
+    bool                reduced;
+    PendulumModes       modes;
     float               angFrequency;
     float               amplitude;
     float               viscosity;
@@ -115,6 +128,9 @@ private:
     qint64              pauseTime;
     float               elapsedTime;
     float               bufferedTime;
+    float               lagTime;
+
+    void updateEquation();
 
     void initializeGL();
     void resizeGL(int w, int h);
@@ -123,6 +139,8 @@ private:
     void paintPendulum(Pendulum const& p);
     void paintCircle(math::float2 const& pos, float radius);
     void paintTime(float t);
+    void paintBuffered(float t);
+    void paintLag(float t);
     void paintCross(math::float2 const& pos, float size);
 
     math::float2 toLocal(QPoint const& pos) const;
@@ -13,6 +13,8 @@ CentralWidget::CentralWidget(QWidget* parent)
     connect(&iface, SIGNAL(pause()), &canvas, SLOT(pause()));
     connect(&iface, SIGNAL(segmentCountChanged(int)),
         &canvas, SLOT(setSegmentCnt(int)));
+    connect(&iface, SIGNAL(modeCountChanged(int)),
+        &canvas, SLOT(setModeCnt(int)));
     connect(&iface, SIGNAL(segmentLengthChanged(float)),
         &canvas, SLOT(setSegmentLength(float)));
     connect(&iface, SIGNAL(nodeMassChanged(float)),
@@ -0,0 +1,269 @@
+#ifndef JG_ENSEMBLE_HPP
+#define JG_ENSEMBLE_HPP
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "pendulum.hpp"
+
+namespace jg {
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                            PendulumEnsemble                                **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Integrates W pendulums with the same segment count in lockstep with RK4.
+// Each lane is one ensemble member with its own coefficients and state. The
+// state is kept structure-of-arrays: component i of lane l is at
+// i * W + l. Every inner loop runs over the W lanes with no branches, so the
+// vectorizer turns it into SSE/AVX code; PendulumHeadless.pro enables it.
+// The driver cosine is advanced by rotation instead of a per-lane std::cos()
+// call, and it is resynchronised with std::cos() every RESYNC_INTERVAL
+// steps. The angle is kept in double and resynchronised at the step count
+// times the step, whatever T: in float, rotations and x summed step by step
+// drift apart by enough for the jumps at every resynchronisation to shake
+// the chain.
+template <typename T, size_t W = 8>
+class PendulumEnsemble
+{
+public:
+    static size_t const LANE_CNT        = W;
+    static size_t const RESYNC_INTERVAL = 1024;
+
+    PendulumEnsemble(
+        size_t              segmentCnt,
+        typename ODE<T>::X  step = Integrator<T>::DEFAULT_STEP
+    );
+
+    size_t              segmentCnt() const;
+    size_t              dimension() const;
+    typename ODE<T>::X  x() const;
+    void                setLane(size_t lane, PendulumODEFun<T> const& f,
+                            typename ODE<T>::Y const& y);
+    void                state(size_t lane, typename ODE<T>::Y& y) const;
+    T                   component(size_t lane, size_t i) const;
+    void                advance();
+
+private:
+    size_t const        n;
+    typename ODE<T>::X  h;
+    typename ODE<T>::X  xCur;
+    size_t              stepCnt;
+
+    // Per-lane coefficients.
+    T C[W];
+    T L[W];
+    T Q[W];
+    T amplitude[W];
+    T angFrequency[W];
+
+    // cos and sin of angFrequency * x, and of angFrequency * h / 2.
+    double cosW[W];
+    double sinW[W];
+    double cosH[W];
+    double sinH[W];
+
+    std::vector<T> y;
+    std::vector<T> k1;
+    std::vector<T> k2;
+    std::vector<T> k3;
+    std::vector<T> k4;
+    std::vector<T> z;
+
+    void rotate(double* c, double* s) const;
+    void resync();
+    void eval(double const* c, T const* y, T* Dy) const;
+};
+
+template <typename T, size_t W> inline
+PendulumEnsemble<T, W>::PendulumEnsemble(
+    size_t              segmentCnt,
+    typename ODE<T>::X  step
+)
+:   n(segmentCnt),
+    h(step),
+    xCur(0),
+    stepCnt(0),
+    y(2 * (segmentCnt + 1) * W, 0),
+    k1(y.size()),
+    k2(y.size()),
+    k3(y.size()),
+    k4(y.size()),
+    z(y.size())
+{
+    if (segmentCnt == 0)
+        throw std::invalid_argument("PendulumEnsemble::PendulumEnsemble(): \
+Segment count must be greater than zero.");
+    for (size_t l = 0; l < W; ++l)
+    {
+        C[l] = L[l] = Q[l] = amplitude[l] = angFrequency[l] = 0;
+    }
+    resync();
+}
+
+template <typename T, size_t W> inline size_t
+PendulumEnsemble<T, W>::segmentCnt() const { return n; }
+
+template <typename T, size_t W> inline size_t
+PendulumEnsemble<T, W>::dimension() const { return 2 * (n + 1); }
+
+template <typename T, size_t W> inline typename ODE<T>::X
+PendulumEnsemble<T, W>::x() const { return xCur; }
+
+template <typename T, size_t W>
+inline void
+PendulumEnsemble<T, W>::setLane(
+    size_t                      lane,
+    PendulumODEFun<T> const&    f,
+    typename ODE<T>::Y const&   state
+)
+{
+    if (lane >= W || state.size() != dimension())
+        throw std::invalid_argument("PendulumEnsemble::setLane(): Lane or \
+state dimension out of range.");
+
+    C[lane]             = f.C;
+    L[lane]             = f.L;
+    Q[lane]             = f.Q;
+    amplitude[lane]     = f.amplitude;
+    angFrequency[lane]  = f.angFrequency;
+    for (size_t i = 0; i < state.size(); ++i) y[i * W + lane] = state[i];
+    resync();
+}
+
+template <typename T, size_t W>
+inline void
+PendulumEnsemble<T, W>::state(size_t lane, typename ODE<T>::Y& state) const
+{
+    if (lane >= W)
+        throw std::invalid_argument("PendulumEnsemble::state(): Lane out of \
+range.");
+
+    state.resize(dimension());
+    for (size_t i = 0; i < state.size(); ++i) state[i] = y[i * W + lane];
+}
+
+// Component i of the state of a lane, without copying the rest. Unchecked.
+template <typename T, size_t W> inline T
+PendulumEnsemble<T, W>::component(size_t lane, size_t i) const
+{ return y[i * W + lane]; }
+
+template <typename T, size_t W>
+void
+PendulumEnsemble<T, W>::advance()
+{
+    size_t const size = y.size();
+    T const h2 = h / 2;
+    T const h6 = h / 6;
+    double c[W];
+    double s[W];
+
+    for (size_t l = 0; l < W; ++l)
+    {
+        c[l] = cosW[l];
+        s[l] = sinW[l];
+    }
+
+    eval(c, &y[0], &k1[0]);
+    rotate(c, s);
+    for (size_t i = 0; i < size; ++i) z[i] = y[i] + h2 * k1[i];
+    eval(c, &z[0], &k2[0]);
+    for (size_t i = 0; i < size; ++i) z[i] = y[i] + h2 * k2[i];
+    eval(c, &z[0], &k3[0]);
+    rotate(c, s);
+    for (size_t i = 0; i < size; ++i) z[i] = y[i] + h * k3[i];
+    eval(c, &z[0], &k4[0]);
+    for (size_t i = 0; i < size; ++i)
+        y[i] += h6 * (k1[i] + 2 * k2[i] + 2 * k3[i] + k4[i]);
+
+    xCur += h;
+    if (++stepCnt % RESYNC_INTERVAL == 0) resync();
+    else for (size_t l = 0; l < W; ++l)
+    {
+        cosW[l] = c[l];
+        sinW[l] = s[l];
+    }
+}
+
+// Advances the angles in (c, s) by angFrequency * h / 2.
+template <typename T, size_t W>
+inline void
+PendulumEnsemble<T, W>::rotate(double* c, double* s) const
+{
+    for (size_t l = 0; l < W; ++l)
+    {
+        double const cl = c[l] * cosH[l] - s[l] * sinH[l];
+        s[l] = s[l] * cosH[l] + c[l] * sinH[l];
+        c[l] = cl;
+    }
+}
+
+template <typename T, size_t W>
+inline void
+PendulumEnsemble<T, W>::resync()
+{
+    double const x = stepCnt * static_cast<double>(h);
+    for (size_t l = 0; l < W; ++l)
+    {
+        double const w = angFrequency[l];
+        cosW[l] = std::cos(w * x);
+        sinW[l] = std::sin(w * x);
+        cosH[l] = std::cos(w * h / 2);
+        sinH[l] = std::sin(w * h / 2);
+    }
+}
+
+// The PendulumODEFun recurrence for all lanes, with c holding
+// cos(angFrequency * x).
+template <typename T, size_t W>
+inline void
+PendulumEnsemble<T, W>::eval(double const* c, T const* y, T* Dy) const
+{
+    int const n = this->n;
+    T const* const v  = y + (n + 1) * W;
+    T* const       Dv = Dy + (n + 1) * W;
+
+    // Local copies, which the stores below provably cannot alias.
+    T Cl[W];
+    T Ll[W];
+    T Ql[W];
+    for (size_t l = 0; l < W; ++l)
+    {
+        Cl[l] = C[l];
+        Ll[l] = L[l];
+        Ql[l] = Q[l];
+    }
+
+    for (size_t l = 0; l < W; ++l)
+    {
+        Dy[l] = amplitude[l] * angFrequency[l] * static_cast<T>(c[l]);
+        Dv[l] = 0;
+    }
+    for (size_t i = W; i < (n + 1) * W; ++i) Dy[i] = v[i];
+    for (int k = 1; k <= n; ++k)
+    {
+        T const a = static_cast<T>(n - k + 1);
+        T const b = static_cast<T>(n - k);
+        T const d = static_cast<T>(2 * (n - k) + 1);
+        T const* const yk = y + k * W;
+        T const* const prev = yk - W;
+        T const* const vk = v + k * W;
+        T* const       Dvk = Dv + k * W;
+        // For k == n the coefficient b is zero, so the node past the end
+        // is never read.
+        T const* const next = k < n ? yk + W : yk;
+
+        for (size_t l = 0; l < W; ++l)
+            Dvk[l] = Cl[l] * (a * prev[l] + b * next[l] - d * yk[l])
+                - vk[l] * (Ll[l] + Ql[l] * std::abs(vk[l]));
+    }
+}
+
+} // namespace jg
+
+#endif // JG_ENSEMBLE_HPP
@@ -0,0 +1,99 @@
+#ifndef JG_EVENTCOUNT_HPP
+#define JG_EVENTCOUNT_HPP
+
+#include <atomic>
+
+#include <QtCore/QtCore>
+
+namespace jg {
+
+// Lets a thread sleep until a condition on lock-free data becomes true,
+// without the notifying side taking a lock unless someone is asleep. The
+// waiting side follows the pattern
+//
+//     while (!condition())
+//     {
+//         EventCount::Key key = event.prepareWait();
+//         if (condition()) event.cancelWait();
+//         else event.wait(key);
+//     }
+//
+// and the notifying side calls notify() after making the condition true.
+class EventCount
+{
+public:
+    typedef unsigned int Key;
+
+    EventCount();
+
+    Key     prepareWait();
+    void    cancelWait();
+    void    wait(Key key);
+    bool    wait(Key key, unsigned long time);
+    void    notify();
+
+private:
+    std::atomic<unsigned int>   m_epoch;
+    std::atomic<int>            m_waiters;
+    QMutex                      m_mutex;
+    QWaitCondition              m_waitCondition;
+};
+
+inline
+EventCount::EventCount()
+:   m_epoch(0),
+    m_waiters(0)
+{/* Do nothing. */}
+
+inline EventCount::Key
+EventCount::prepareWait()
+{
+    m_waiters.fetch_add(1);
+    return m_epoch.load();
+}
+
+inline void
+EventCount::cancelWait()
+{
+    m_waiters.fetch_sub(1);
+}
+
+inline void
+EventCount::wait(Key key)
+{
+    m_mutex.lock();
+        while (m_epoch.load() == key) m_waitCondition.wait(&m_mutex);
+    m_mutex.unlock();
+    m_waiters.fetch_sub(1);
+}
+
+// Like wait(), but gives up after time milliseconds without a notification,
+// returning false then.
+inline bool
+EventCount::wait(Key key, unsigned long time)
+{
+    bool notified = true;
+    m_mutex.lock();
+        while (notified && m_epoch.load() == key)
+            notified = m_waitCondition.wait(&m_mutex, time);
+    m_mutex.unlock();
+    m_waiters.fetch_sub(1);
+    return notified;
+}
+
+inline void
+EventCount::notify()
+{
+    // Orders the caller's update of the condition before the check for
+    // waiters, pairing with the increment in prepareWait().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiters.load() == 0) return;
+    m_mutex.lock();
+        m_epoch.fetch_add(1);
+    m_mutex.unlock();
+    m_waitCondition.wakeAll();
+}
+
+} // namespace jg
+
+#endif // JG_EVENTCOUNT_HPP
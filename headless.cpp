@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include <QtCore/QtCore>
+
+#include "scenario.hpp"
+#include "sweep.hpp"
+
+namespace jg {
+
+// Lookahead of the solution in output intervals. Gives the producer enough
+// slack to keep integrating while the consumer writes.
+int const LOOKAHEAD_INTERVALS = 256;
+
+// Integrates the scenario as fast as it goes, writing the state at every
+// output interval to out as CSV: the time, the deflections x0, ..., xn and
+// the velocities v0, ..., vn. Reports the throughput to std::cerr, and for a
+// reduced model the largest estimated error of the deflections. The nodes
+// of a reduced model are reconstructed for the output only.
+template <typename T>
+void
+simulate(Scenario const& scenario, std::ostream& out)
+{
+    ODEFun<T>* const f = scenario.newEquation<T>();
+    ReducedPendulumODEFun<T> const* const reduced
+        = dynamic_cast<ReducedPendulumODEFun<T> const*>(f);
+    ODESolution<T> solution(0, scenario.initialState<T>(), NULL,
+        scenario.newIntegrator<T>());
+    solution.setEquation(f);
+    solution.setOutputInterval(static_cast<T>(scenario.outputInterval));
+    solution.setLookahead(
+        static_cast<T>(LOOKAHEAD_INTERVALS * scenario.outputInterval));
+
+    size_t const m = scenario.segmentCnt + 1;
+    out << "t";
+    for (size_t i = 0; i < m; ++i) out << ",x" << i;
+    for (size_t i = 0; i < m; ++i) out << ",v" << i;
+    out << "\n" << std::setprecision(std::numeric_limits<T>::digits10 + 2);
+
+    QElapsedTimer timer;
+    timer.start();
+    solution.start();
+    // The output times are computed rather than accumulated, so that the
+    // rounding does not drift.
+    size_t const outputCnt = static_cast<size_t>(
+        scenario.duration / scenario.outputInterval + 0.5);
+    typename ODE<T>::Y nodes(2 * m);
+    T error = 0;
+    for (size_t k = 0; k <= outputCnt; ++k)
+    {
+        T const t = static_cast<T>(k * scenario.outputInterval);
+        typename ODE<T>::Y const y = solution(t);
+        if (reduced != NULL)
+        {
+            reduced->modes().reconstruct(&y[0], &nodes[0]);
+            error = std::max(error, reduced->errorEstimate(t, &y[0]));
+        }
+        typename ODE<T>::Y const& state = reduced != NULL ? nodes : y;
+        out << t;
+        for (size_t i = 0; i < state.size(); ++i) out << "," << state[i];
+        out << "\n";
+    }
+    solution.stop();
+    out.flush();
+
+    double const seconds = timer.nsecsElapsed() / 1e9;
+    std::cerr << "Simulated " << scenario.duration << " s in " << seconds
+        << " s, " << scenario.duration / seconds
+        << " simulated seconds per second." << std::endl;
+    if (reduced != NULL)
+        std::cerr << "Reduced to " << scenario.modeCnt << " of "
+            << scenario.segmentCnt << " modes, estimated deflection error "
+            << "at most " << error << "." << std::endl;
+}
+
+// Runs the cases of the sweep on all cores, writing their metrics to out.
+void
+sweep(QString const& path, std::ostream& out)
+{
+    Sweep const sweep = Sweep::load(path);
+    QElapsedTimer timer;
+    timer.start();
+    int const threadCnt = QThread::idealThreadCount();
+    std::vector<Sweep::Result> const results = sweep.run(threadCnt);
+    sweep.write(out, results);
+
+    double const seconds = timer.nsecsElapsed() / 1e9;
+    double busy = 0;
+    for (size_t i = 0; i < results.size(); ++i) busy += results[i].seconds;
+    std::cerr << "Ran " << results.size() << " cases on " << threadCnt
+        << " threads in " << seconds << " s, " << busy / seconds
+        << " cases' worth of time per second." << std::endl;
+}
+
+} // namespace jg
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " scenario.ini [output.csv]\n"
+            "Writes to the standard output when no output file is given. A\n"
+            "scenario with a sweep group runs a parameter sweep."
+            << std::endl;
+        return 2;
+    }
+
+    int retCode = 0;
+    try
+    {
+        std::ofstream file;
+        if (argc == 3)
+        {
+            file.open(argv[2]);
+            if (!file)
+                throw std::runtime_error("Unable to open "
+                    + std::string(argv[2]) + ".");
+        }
+        std::ostream& out = argc == 3 ? file : std::cout;
+        if (jg::Sweep::isSweep(argv[1])) jg::sweep(argv[1], out);
+        else
+        {
+            jg::Scenario const scenario = jg::Scenario::load(argv[1]);
+            if (scenario.precision == jg::Scenario::FLOAT)
+                jg::simulate<float>(scenario, out);
+            else jg::simulate<double>(scenario, out);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception caught:\n\t" << e.what() << std::endl;
+        retCode = 1;
+    }
+    catch(...)
+    {
+        std::cerr << "Unknown exception caught." << std::endl;
+        retCode = 1;
+    }
+
+    return retCode;
+}
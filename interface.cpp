@@ -1,4 +1,5 @@
 #include "interface.hpp"
+#include "pendulum.hpp"
 #include <iostream>
 #include <sstream>
 #include <cmath>
@@ -18,9 +19,10 @@ float const Interface::DEFAULT_NODE_MASS        = 1;
 float const Interface::MIN_NODE_RADIUS          = 0.05;
 float const Interface::MAX_NODE_RADIUS          = 0.5;
 float const Interface::DEFAULT_NODE_RADIUS      = 0.25;
-int const   Interface::MAX_RESONANCE_SUPPORT    = 9;
 float const Interface::MIN_ANG_FREQUENCY        = 0;
-float const Interface::MAX_ANG_FREQUENCY        = 50;
+// Above the highest resonance, 68.95 rad/s, of MAX_SEGMENT_COUNT segments of
+// MIN_SEGMENT_LENGTH, so that every resonance preset fits the slider.
+float const Interface::MAX_ANG_FREQUENCY        = 70;
 float const Interface::DEFAULT_ANG_FREQUENCY    = 20;
 float const Interface::MIN_AMPLITUDE            = 0;
 float const Interface::MAX_AMPLITUDE            = 0.5;
@@ -46,68 +48,15 @@ Interface::Interface(QWidget* parent)
     pendulumPropertiesGroupBox("Pendulum properties"),
     driverPropertiesGroupBox("Driver properties."),
     fluidPropertiesGroupBox("Fluid properties"),
-    integratorPropertiesGroupBox("Integrator properties"),
-    lambdas(MAX_RESONANCE_SUPPORT + 1)
+    integratorPropertiesGroupBox("Integrator properties")
 {
-    lambdas[1].push_back(1.000000000000);
-    
-    lambdas[2].push_back(0.585786437627);
-    lambdas[2].push_back(3.414213562373);
-    
-    lambdas[3].push_back(0.415774556783);
-    lambdas[3].push_back(2.294280360279);
-    lambdas[3].push_back(6.289945082937);
-    
-    lambdas[4].push_back(0.322547689619);
-    lambdas[4].push_back(1.745761101158);
-    lambdas[4].push_back(4.536620296921);
-    lambdas[4].push_back(9.395070912301);
-    
-    lambdas[5].push_back(.263560319718); 
-    lambdas[5].push_back(1.413403059107);
-    lambdas[5].push_back(3.596425771041);
-    lambdas[5].push_back(7.085810005859);
-    lambdas[5].push_back(12.640800844276);
-
-    lambdas[6].push_back(0.222846604179);
-    lambdas[6].push_back(1.188932101673); 
-    lambdas[6].push_back(2.992736326059);
-    lambdas[6].push_back(5.775143569105);
-    lambdas[6].push_back(9.837467418383); 
-    lambdas[6].push_back(15.982873980602);
-
-    lambdas[7].push_back(0.193043676560); 
-    lambdas[7].push_back(1.026664895339);
-    lambdas[7].push_back(2.567876744951); 
-    lambdas[7].push_back(4.900353084526); 
-    lambdas[7].push_back(8.182153444563);
-    lambdas[7].push_back(12.734180291798);
-    lambdas[7].push_back(19.395727862263);
-
-    lambdas[8].push_back(0.170279632305); 
-    lambdas[8].push_back(0.903701776799); 
-    lambdas[8].push_back(2.251086629866); 
-    lambdas[8].push_back(4.266700170288); 
-    lambdas[8].push_back(7.045905402393); 
-    lambdas[8].push_back(10.758516010181); 
-    lambdas[8].push_back(15.740678641278); 
-    lambdas[8].push_back(22.863131736889); 
-    
-    lambdas[9].push_back(0.152322227732); 
-    lambdas[9].push_back(0.807220022742); 
-    lambdas[9].push_back(2.005135155619); 
-    lambdas[9].push_back(3.783473973331); 
-    lambdas[9].push_back(6.204956777877); 
-    lambdas[9].push_back(9.372985251688); 
-    lambdas[9].push_back(13.466236911092); 
-    lambdas[9].push_back(18.833597788992); 
-    lambdas[9].push_back(26.374071890927);
-
     connect(&startButton, SIGNAL(clicked()), this, SLOT(startButtonClicked()));
     connect(&stopButton, SIGNAL(clicked()), this, SLOT(stopButtonClicked()));
     connect(&pauseButton, SIGNAL(clicked()), this, SLOT(pauseButtonClicked()));
     connect(&segmentCountSpinBox, SIGNAL(valueChanged(int)),
         this, SLOT(segmentCountSpinBoxValueChanged(int)));
+    connect(&modeCountSpinBox, SIGNAL(valueChanged(int)),
+        this, SLOT(modeCountSpinBoxValueChanged(int)));
     connect(&segmentLengthSpinSlider, SIGNAL(valueChanged(double)),
         this, SLOT(segmentLengthSpinSliderValueChanged(double)));
     connect(&nodeMassSpinSlider, SIGNAL(valueChanged(double)),
@@ -153,6 +102,13 @@ Interface::Interface(QWidget* parent)
     segmentCountLayout->addWidget(new QLabel("Segment count"));
     segmentCountLayout->addWidget(&segmentCountSpinBox);
     pendulumPropertiesLayout->addLayout(segmentCountLayout);
+    // Fewer modes than segments simulate the reduced model, for long chains.
+    QHBoxLayout* modeCountLayout = new QHBoxLayout();
+    modeCountSpinBox.setRange(0, MAX_SEGMENT_COUNT);
+    modeCountSpinBox.setSpecialValueText("All");
+    modeCountLayout->addWidget(new QLabel("Modes"));
+    modeCountLayout->addWidget(&modeCountSpinBox);
+    pendulumPropertiesLayout->addLayout(modeCountLayout);
     pendulumPropertiesLayout->addWidget(new QLabel("Segment length"));
     segmentLengthSpinSlider.setRange(MIN_SEGMENT_LENGTH, MAX_SEGMENT_LENGTH);
     pendulumPropertiesLayout->addLayout(&segmentLengthSpinSlider);
@@ -193,6 +149,11 @@ Interface::Interface(QWidget* parent)
     integratorLayout->addWidget(new QLabel("Integrator"));
     integratorComboBox.addItem("Euler");
     integratorComboBox.addItem("RK4");
+    integratorComboBox.addItem("Dormand-Prince");
+    integratorComboBox.addItem("Verlet");
+    integratorComboBox.addItem("Forest-Ruth");
+    integratorComboBox.addItem("Rosenbrock");
+    integratorComboBox.addItem("Modal");
     integratorLayout->addWidget(&integratorComboBox);
     QHBoxLayout* precisionLayout = new QHBoxLayout;
     precisionLayout->addWidget(new QLabel("Precision"));
@@ -223,6 +184,7 @@ void
 Interface::setDefault()
 {
     segmentCountSpinBox.setValue(DEFAULT_SEGMENT_COUNT);
+    modeCountSpinBox.setValue(0);
     segmentLengthSpinSlider.setValue(DEFAULT_SEGMENT_LENGTH);
     nodeMassSpinSlider.setValue(DEFAULT_NODE_MASS);
     nodeRadiusSpinSlider.setValue(DEFAULT_NODE_RADIUS);
@@ -239,6 +201,7 @@ void
 Interface::broadcast()
 {
     emit segmentCountChanged(segmentCountSpinBox.value());
+    emit modeCountChanged(modeCountSpinBox.value());
     emit segmentLengthChanged(segmentLengthSpinSlider.value());
     emit nodeMassChanged(nodeMassSpinSlider.value());
     emit nodeRadiusChanged(nodeRadiusSpinSlider.value());
@@ -261,9 +224,8 @@ Interface::startButtonClicked()
     startButton.setEnabled(false);
     stopButton.setEnabled(true);
     pauseButton.setEnabled(true);
+    // The driver and the fluid may be changed on the fly.
     pendulumPropertiesGroupBox.setEnabled(false);
-    driverPropertiesGroupBox.setEnabled(false);
-    fluidPropertiesGroupBox.setEnabled(false);
     integratorPropertiesGroupBox.setEnabled(false);
     emit start();
 }
@@ -275,8 +237,6 @@ Interface::stopButtonClicked()
     stopButton.setEnabled(false);
     pauseButton.setEnabled(false);
     pendulumPropertiesGroupBox.setEnabled(true);
-    driverPropertiesGroupBox.setEnabled(true);
-    fluidPropertiesGroupBox.setEnabled(true);
     integratorPropertiesGroupBox.setEnabled(true);
     emit stop();
 }
@@ -296,19 +256,16 @@ void Interface::segmentCountSpinBoxValueChanged(int value)
 
     angFrequencyComboBox.setCurrentIndex(0);
     angFrequencySpinSlider.setEnabled(true);
-    if (value > MAX_RESONANCE_SUPPORT)
-        angFrequencyComboBox.setEnabled(false);
-    else
-    {
-        angFrequencyComboBox.setEnabled(true);
-        while (angFrequencyComboBox.count() > value + 1)
-            angFrequencyComboBox.removeItem(angFrequencyComboBox.count() - 1);
-        while (angFrequencyComboBox.count() <= value)
-            angFrequencyComboBox.addItem("Resonance "
-                + QString::number(angFrequencyComboBox.count()));
-    }
+    while (angFrequencyComboBox.count() > value + 1)
+        angFrequencyComboBox.removeItem(angFrequencyComboBox.count() - 1);
+    while (angFrequencyComboBox.count() <= value)
+        angFrequencyComboBox.addItem("Resonance "
+            + QString::number(angFrequencyComboBox.count()));
 }
 
+void Interface::modeCountSpinBoxValueChanged(int value)
+{ emit modeCountChanged(value); }
+
 void Interface::segmentLengthSpinSliderValueChanged(double value)
 { emit segmentLengthChanged(value); }
 
@@ -323,10 +280,9 @@ void Interface::angFrequencyComboBoxCurrentIndexChanged(int value)
     if (value > 0)
     {
         angFrequencySpinSlider.setEnabled(false);
-        angFrequencySpinSlider.setValue(
-            std::sqrt(lambdas[segmentCountSpinBox.value()][value - 1]
-            * 9.81 / segmentLengthSpinSlider.value() )
-        );
+        angFrequencySpinSlider.setValue(resonanceFrequency(
+            segmentCountSpinBox.value(), segmentLengthSpinSlider.value(),
+            value));
     }
     else angFrequencySpinSlider.setEnabled(true);
 }
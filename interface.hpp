@@ -4,7 +4,6 @@
 #include <QtGui>
 #include <QtWidgets>
 
-#include <vector>
 #include "spinslider.hpp"
 
 namespace jg
@@ -31,7 +30,6 @@ public:
     static float const  MIN_NODE_RADIUS;
     static float const  MAX_NODE_RADIUS;
     static float const  DEFAULT_NODE_RADIUS;
-    static int const    MAX_RESONANCE_SUPPORT;
     static float const  MIN_ANG_FREQUENCY;
     static float const  MAX_ANG_FREQUENCY;
     static float const  DEFAULT_ANG_FREQUENCY;
@@ -55,6 +53,7 @@ public:
 
     QGroupBox   pendulumPropertiesGroupBox;
     QSpinBox    segmentCountSpinBox;
+    QSpinBox    modeCountSpinBox;
     SpinSlider  segmentLengthSpinSlider;
     SpinSlider  nodeMassSpinSlider;
     SpinSlider  nodeRadiusSpinSlider;
@@ -78,6 +77,7 @@ private slots:
     void stopButtonClicked();
     void pauseButtonClicked();
     void segmentCountSpinBoxValueChanged(int value);
+    void modeCountSpinBoxValueChanged(int value);
     void segmentLengthSpinSliderValueChanged(double value);
     void nodeMassSpinSliderValueChanged(double value);
     void nodeRadiusSpinSliderValueChanged(double value);
@@ -95,6 +95,7 @@ signals:
     void stop();
     void pause();
     void segmentCountChanged(int);
+    void modeCountChanged(int);
     void segmentLengthChanged(float);
     void nodeMassChanged(float);
     void nodeRadiusChanged(float);
@@ -105,9 +106,6 @@ signals:
     void integratorChanged(QString const&);
     void precisionChanged(QString const&);
     void stepChanged(int);
-
-private:
-    std::vector<std::vector<double> > lambdas;
 };
 
 } // namespace jg
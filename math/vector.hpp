@@ -6,32 +6,201 @@
 #include "vector4.hpp"
 
 #include <vector>
+#include <cstddef>
+#include <type_traits>
 
-// TODO
+// Arithmetic on std::vector is lazy. Every operator below returns a small
+// expression object that refers to its operands, and nothing is computed
+// until the expression is assigned, added to a vector or converted to one.
+// A whole combination like (k1 + 2 * k2 + 2 * k3 + k4) / 6 is then a single
+// loop with a single store per element.
+//
+// Expressions refer to their vector operands, so they must not outlive the
+// full expression they are created in.
 
-template <typename T> inline
-std::vector<T>& operator += (std::vector<T>& a, std::vector<T> const& b)
+namespace jg
+{
+namespace math
+{
+
+template <typename V>
+struct vector_traits
+{
+	static bool const is_operand = false;
+};
+
+template <typename T, typename A>
+struct vector_traits<std::vector<T, A> >
+{
+	static bool const is_operand = true;
+	typedef T value_type;
+	typedef std::vector<T, A> const& ref_type;
+};
+
+template <typename A, typename B, typename Op>
+class vector_binary
+{
+  public:
+	typedef typename vector_traits<A>::value_type value_type;
+
+	vector_binary(A const& a, B const& b) : a(a), b(b) {/* Do nothing. */}
+
+	size_t size() const { return a.size(); }
+	value_type operator [] (size_t i) const { return Op::apply(a[i], b[i]); }
+	operator std::vector<value_type> () const;
+
+  private:
+	typename vector_traits<A>::ref_type a;
+	typename vector_traits<B>::ref_type b;
+};
+
+template <typename A, typename Op>
+class vector_scalar
+{
+  public:
+	typedef typename vector_traits<A>::value_type value_type;
+
+	vector_scalar(A const& a, value_type s) : a(a), s(s) {/* Do nothing. */}
+
+	size_t size() const { return a.size(); }
+	value_type operator [] (size_t i) const { return Op::apply(a[i], s); }
+	operator std::vector<value_type> () const;
+
+  private:
+	typename vector_traits<A>::ref_type a;
+	value_type const s;
+};
+
+template <typename A>
+class vector_negation
+{
+  public:
+	typedef typename vector_traits<A>::value_type value_type;
+
+	explicit vector_negation(A const& a) : a(a) {/* Do nothing. */}
+
+	size_t size() const { return a.size(); }
+	value_type operator [] (size_t i) const { return -a[i]; }
+	operator std::vector<value_type> () const;
+
+  private:
+	typename vector_traits<A>::ref_type a;
+};
+
+struct vector_plus
+{
+	template <typename T> static T apply(T a, T b) { return a + b; }
+};
+
+struct vector_minus
+{
+	template <typename T> static T apply(T a, T b) { return a - b; }
+};
+
+struct vector_times
+{
+	template <typename T> static T apply(T a, T s) { return a * s; }
+};
+
+struct vector_divided
+{
+	template <typename T> static T apply(T a, T s) { return a / s; }
+};
+
+template <typename A, typename B, typename Op>
+struct vector_traits<vector_binary<A, B, Op> >
 {
-	for (int i = 0; i < a.size(); ++i) a[i] += b[i];
+	static bool const is_operand = true;
+	typedef typename vector_traits<A>::value_type value_type;
+	typedef vector_binary<A, B, Op> const ref_type;
+};
+
+template <typename A, typename Op>
+struct vector_traits<vector_scalar<A, Op> >
+{
+	static bool const is_operand = true;
+	typedef typename vector_traits<A>::value_type value_type;
+	typedef vector_scalar<A, Op> const ref_type;
+};
+
+template <typename A>
+struct vector_traits<vector_negation<A> >
+{
+	static bool const is_operand = true;
+	typedef typename vector_traits<A>::value_type value_type;
+	typedef vector_negation<A> const ref_type;
+};
+
+// Evaluates e into v, reusing the storage v already has.
+template <typename T, typename E>
+inline typename std::enable_if<vector_traits<E>::is_operand,
+	std::vector<T>&>::type
+assign(std::vector<T>& v, E const& e)
+{
+	size_t const n = e.size();
+	if (v.size() != n) v.resize(n);
+	for (size_t i = 0; i < n; ++i) v[i] = e[i];
+	return v;
+}
+
+template <typename A, typename B, typename Op>
+inline
+vector_binary<A, B, Op>::operator std::vector<value_type> () const
+{
+	std::vector<value_type> v;
+	assign(v, *this);
+	return v;
+}
+
+template <typename A, typename Op>
+inline
+vector_scalar<A, Op>::operator std::vector<value_type> () const
+{
+	std::vector<value_type> v;
+	assign(v, *this);
+	return v;
+}
+
+template <typename A>
+inline
+vector_negation<A>::operator std::vector<value_type> () const
+{
+	std::vector<value_type> v;
+	assign(v, *this);
+	return v;
+}
+
+} // namespace math
+} // namespace jg
+
+template <typename T, typename E> inline
+typename std::enable_if<jg::math::vector_traits<E>::is_operand,
+	std::vector<T>&>::type
+operator += (std::vector<T>& a, E const& b)
+{
+	for (size_t i = 0; i < a.size(); ++i) a[i] += b[i];
 	return a;
 }
 
-template <typename T> inline
-std::vector<T>& operator -= (std::vector<T>& a, std::vector<T> const& b)
+template <typename T, typename E> inline
+typename std::enable_if<jg::math::vector_traits<E>::is_operand,
+	std::vector<T>&>::type
+operator -= (std::vector<T>& a, E const& b)
 {
-	for (int i = 0; i < a.size(); ++i) a[i] -= b[i];
+	for (size_t i = 0; i < a.size(); ++i) a[i] -= b[i];
 	return a;
 }
 
 template <typename T> inline
 std::vector<T>& operator *= (std::vector<T>& v, T s)
 {
-	for (int i = 0; i < v.size(); ++i) v[i] *= s;
+	for (size_t i = 0; i < v.size(); ++i) v[i] *= s;
 	return v;
 }
 
 template <typename T, typename S> inline
-std::vector<T>& operator *= (std::vector<T>& v, S s)
+typename std::enable_if<std::is_arithmetic<S>::value, std::vector<T>&>::type
+operator *= (std::vector<T>& v, S s)
 {
 	return v *= static_cast<T>(s);
 }
@@ -39,51 +208,70 @@ std::vector<T>& operator *= (std::vector<T>& v, S s)
 template <typename T> inline
 std::vector<T>& operator /= (std::vector<T>& v, T s)
 {
-	for (int i = 0; i < v.size(); ++i) v[i] /= s;
+	for (size_t i = 0; i < v.size(); ++i) v[i] /= s;
 	return v;
 }
 
 template <typename T, typename S> inline
-std::vector<T>& operator /= (std::vector<T>& v, S s)
+typename std::enable_if<std::is_arithmetic<S>::value, std::vector<T>&>::type
+operator /= (std::vector<T>& v, S s)
 {
 	return v /= static_cast<T>(s);
 }
 
-template <typename T> inline
-std::vector<T> operator - (std::vector<T> v)
+template <typename A> inline
+typename std::enable_if<jg::math::vector_traits<A>::is_operand,
+	jg::math::vector_negation<A> >::type
+operator - (A const& a)
 {
-	for (int i = 0; i < v.size(); ++i) v[i] = -v[i];
-	return v;
+	return jg::math::vector_negation<A>(a);
 }
 
-template <typename T> inline
-std::vector<T> operator + (std::vector<T> a, std::vector<T> const& b)
+template <typename A, typename B> inline
+typename std::enable_if<jg::math::vector_traits<A>::is_operand
+	&& jg::math::vector_traits<B>::is_operand,
+	jg::math::vector_binary<A, B, jg::math::vector_plus> >::type
+operator + (A const& a, B const& b)
 {
-	return a += b;
+	return jg::math::vector_binary<A, B, jg::math::vector_plus>(a, b);
 }
 
-template <typename T> inline
-std::vector<T> operator - (std::vector<T> a, std::vector<T> const& b)
+template <typename A, typename B> inline
+typename std::enable_if<jg::math::vector_traits<A>::is_operand
+	&& jg::math::vector_traits<B>::is_operand,
+	jg::math::vector_binary<A, B, jg::math::vector_minus> >::type
+operator - (A const& a, B const& b)
 {
-	return a -= b;
+	return jg::math::vector_binary<A, B, jg::math::vector_minus>(a, b);
 }
 
-template <typename T, typename S> inline
-std::vector<T> operator * (S s, std::vector<T> v)
+template <typename S, typename A> inline
+typename std::enable_if<std::is_arithmetic<S>::value
+	&& jg::math::vector_traits<A>::is_operand,
+	jg::math::vector_scalar<A, jg::math::vector_times> >::type
+operator * (S s, A const& a)
 {
-	return v *= s;
+	return jg::math::vector_scalar<A, jg::math::vector_times>(a,
+		static_cast<typename jg::math::vector_traits<A>::value_type>(s));
 }
 
-template <typename T, typename S> inline
-std::vector<T> operator * (std::vector<T> v, S s)
+template <typename A, typename S> inline
+typename std::enable_if<std::is_arithmetic<S>::value
+	&& jg::math::vector_traits<A>::is_operand,
+	jg::math::vector_scalar<A, jg::math::vector_times> >::type
+operator * (A const& a, S s)
 {
-	return v *= s;
+	return s * a;
 }
 
-template <typename T, typename S> inline
-std::vector<T> operator / (std::vector<T> v, S s)
+template <typename A, typename S> inline
+typename std::enable_if<std::is_arithmetic<S>::value
+	&& jg::math::vector_traits<A>::is_operand,
+	jg::math::vector_scalar<A, jg::math::vector_divided> >::type
+operator / (A const& a, S s)
 {
-	return v /= s;
+	return jg::math::vector_scalar<A, jg::math::vector_divided>(a,
+		static_cast<typename jg::math::vector_traits<A>::value_type>(s));
 }
 
 #endif /* JG_MATH_VECTOR_HPP */
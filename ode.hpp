@@ -1,9 +1,18 @@
 #ifndef JG_ODE_HPP
 #define JG_ODE_HPP
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <typeinfo>
+
 #include "math/math.hpp"
+#include "block_tridiagonal.hpp"
+#include "symmetric_tridiagonal.hpp"
 #include "spawner.hpp"
 #include "buffer.hpp"
+#include "trajectory.hpp"
 
 namespace jg {
 
@@ -15,17 +24,36 @@ namespace jg {
 ********************************************************************************
 *******************************************************************************/
 
-template <typename T>
+// Dimension argument selecting the std::vector based state, whose size is
+// only known at run time.
+size_t const DYNAMIC_SIZE = 0;
+
+// State of compile-time dimension N kept in a std::array, so loops over it
+// have a constant trip count and can be unrolled, and a small one can live
+// in registers. The points of a solution stay dynamic; the fixed state is
+// that of the stages of RK4Integrator<T, N, F>.
+template <typename T, size_t N = DYNAMIC_SIZE>
 class ODE
 {
+public:
+    typedef T                   X;
+    typedef std::array<T, N>    Y;
+};
+
+template <typename T>
+class ODE<T, DYNAMIC_SIZE>
+{
 public:
     typedef T               X;
     typedef std::vector<T>  Y;
     
+    // The derivative dy at (x, y) is optional and left empty when unknown.
+    // Whoever changes x or y must update or clear it.
     struct Point
     {
         X x;
         Y y;
+        Y dy;
 
         Point(X x = 0, Y y = Y(1, 0))
         : x(x), y(y)
@@ -46,10 +74,116 @@ class ODEFun
 {
 public:
     virtual ~ODEFun() {/* Do nothing. */}
-    virtual typename ODE<T>::Y operator () (typename ODE<T>::X x,
-        typename ODE<T>::Y const& y) const = 0;
+
+    // Writes the derivative at (x, y) to dy. Both arrays hold size elements
+    // and must not overlap.
+    virtual void eval(typename ODE<T>::X x, T const* y, T* dy, size_t size)
+        const = 0;
+
+    // Fills J with the Jacobian of the function with respect to y at (x, y)
+    // and returns true, or returns false if the function cannot provide it,
+    // in which case callers fall back to finiteDifferenceJacobian().
+    virtual bool jacobian(typename ODE<T>::X x, T const* y, size_t size,
+        BlockTridiagonal<T>& J) const;
+
+    // Writes the derivative of the positions, the first half of the state
+    // of a second order system, at (x, y) to dq, which holds size / 2
+    // elements, and returns true, or returns false if the function cannot
+    // give it apart from eval(). Splitting integrators drift with it.
+    virtual bool positionDerivative(typename ODE<T>::X x, T const* y, T* dq,
+        size_t size) const;
+
+    typename ODE<T>::Y operator () (typename ODE<T>::X x,
+        typename ODE<T>::Y const& y) const;
 };
 
+template <typename T>
+inline bool
+ODEFun<T>::jacobian(
+    typename ODE<T>::X,
+    T const*,
+    size_t,
+    BlockTridiagonal<T>&
+) const
+{
+    return false;
+}
+
+template <typename T>
+inline bool
+ODEFun<T>::positionDerivative(
+    typename ODE<T>::X,
+    T const*,
+    T*,
+    size_t
+) const
+{
+    return false;
+}
+
+template <typename T>
+inline typename ODE<T>::Y
+ODEFun<T>::operator () (
+    typename ODE<T>::X          x,
+    typename ODE<T>::Y const&   y
+) const
+{
+    typename ODE<T>::Y dy(y.size());
+    eval(x, &y[0], &dy[0], y.size());
+    return dy;
+}
+
+// Approximates the Jacobian of f at (x, y), where dy = f(x, y), by forward
+// differences. The nodes of the state are assumed to be coupled to their
+// neighbours only, as in BlockTridiagonal. Columns of nodes three apart then
+// affect disjoint rows and are perturbed together, so the estimate takes six
+// evaluations of f whatever the size. z and dz are workspace.
+template <typename T>
+void
+finiteDifferenceJacobian(
+    ODEFun<T> const&            f,
+    typename ODE<T>::X          x,
+    typename ODE<T>::Y const&   y,
+    typename ODE<T>::Y const&   dy,
+    BlockTridiagonal<T>&        J,
+    typename ODE<T>::Y&         z,
+    typename ODE<T>::Y&         dz
+)
+{
+    size_t const n = y.size();
+    size_t const m = n / 2;
+    T const eps = std::sqrt(std::numeric_limits<T>::epsilon());
+
+    if (J.nodeCnt() != m) J.resize(m);
+    else J.setZero();
+    z = y;
+    dz.resize(n);
+
+    for (size_t component = 0; component < 2; ++component)
+    for (size_t color = 0; color < 3; ++color)
+    {
+        for (size_t k = color; k < m; k += 3)
+        {
+            size_t const j = component * m + k;
+            z[j] += eps * std::max(std::abs(y[j]), static_cast<T>(1));
+        }
+        f.eval(x, &z[0], &dz[0], n);
+        for (size_t k = color; k < m; k += 3)
+        {
+            size_t const j = component * m + k;
+            T const delta = z[j] - y[j];
+            size_t const lo = k > 0 ? k - 1 : 0;
+            size_t const hi = std::min(k + 1, m - 1);
+            for (size_t r = lo; r <= hi; ++r)
+            {
+                J(r, j)     = (dz[r] - dy[r]) / delta;
+                J(m + r, j) = (dz[m + r] - dy[m + r]) / delta;
+            }
+            z[j] = y[j];
+        }
+    }
+}
+
 /*******************************************************************************
 ********************************************************************************
 **                                                                            **
@@ -58,6 +192,9 @@ public:
 ********************************************************************************
 *******************************************************************************/
 
+// Integrators take the derivative at the starting point from p.dy when it
+// is known, and either leave the derivative at the new point in p.dy, if
+// they get it for free, or clear it.
 template <typename T>
 class Integrator
 {
@@ -66,6 +203,12 @@ public:
 
     virtual ~Integrator() {/* Do nothing. */}
     virtual void advance(typename ODE<T>::Point& p, ODEFun<T> const& f) = 0;
+
+    // Nominal step size, or the largest one for adaptive integrators.
+    virtual typename ODE<T>::X step() const = 0;
+
+    // Whether the integrator picks its own, possibly much smaller, steps.
+    virtual bool adaptive() const { return false; }
 };
 
 template <typename T>
@@ -85,6 +228,7 @@ class EulerIntegrator : public Integrator<T>
 public:
     EulerIntegrator(typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP);
     void advance(typename ODE<T>::Point& point, ODEFun<T> const& f);
+    typename ODE<T>::X step() const { return h; }
 
 private:
     typename ODE<T>::X h;
@@ -99,8 +243,15 @@ template <typename T>
 inline void
 EulerIntegrator<T>::advance(typename ODE<T>::Point& p, ODEFun<T> const& f)
 {
-    p.y += h * f(p.x, p.y);
+    size_t const n = p.y.size();
+    if (p.dy.size() != n)
+    {
+        p.dy.resize(n);
+        f.eval(p.x, &p.y[0], &p.dy[0], n);
+    }
+    p.y += h * p.dy;
     p.x += h;
+    f.eval(p.x, &p.y[0], &p.dy[0], n);
 }
 
 /*******************************************************************************
@@ -111,32 +262,973 @@ EulerIntegrator<T>::advance(typename ODE<T>::Point& p, ODEFun<T> const& f)
 ********************************************************************************
 *******************************************************************************/
 
+// F is the type of the right-hand side the fixed-size integrator calls
+// directly, see below, and must be given along with N. The dynamic
+// integrator takes any.
+template <typename T, size_t N = DYNAMIC_SIZE, typename F = ODEFun<T> >
+class RK4Integrator;
+
 template <typename T>
-class RK4Integrator : public Integrator<T>
+class RK4Integrator<T, DYNAMIC_SIZE, ODEFun<T> > : public Integrator<T>
 {
 public:
     RK4Integrator(typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP)
     :   h(step)
     {/* Do nothing. */}
 
+    typename ODE<T>::X step() const { return h; }
+
     void advance(typename ODE<T>::Point& p, ODEFun<T> const& f)
     {
         typename ODE<T>::X& x = p.x;
         typename ODE<T>::Y& y = p.y;
+        size_t const n = y.size();
+        T const h2 = h / 2;
+        T const h6 = h / 6;
+
+        // The stage vectors are members, so once they have grown to the
+        // system dimension no further storage is needed. The first stage is
+        // the derivative at the point, which the previous step has left in
+        // p.dy, and the derivative at the new point is the first stage of
+        // the next step.
+        if (z.size() != n)
+        {
+            k2.resize(n);
+            k3.resize(n);
+            k4.resize(n);
+            z.resize(n);
+        }
+        if (p.dy.size() != n)
+        {
+            p.dy.resize(n);
+            f.eval(x, &y[0], &p.dy[0], n);
+        }
+        typename ODE<T>::Y const& k1 = p.dy;
 
-        typename ODE<T>::Y const k1 = h * f(x          , y               );
-        typename ODE<T>::Y const k2 = h * f(x + 0.5 * h, y + 0.5 * h * k1);
-        typename ODE<T>::Y const k3 = h * f(x + 0.5 * h, y + 0.5 * h * k2);
-        typename ODE<T>::Y const k4 = h * f(x + h      , y + h * k3      );
+        math::assign(z, y + h2 * k1);
+        f.eval(x + h2, &z[0], &k2[0], n);
+        math::assign(z, y + h2 * k2);
+        f.eval(x + h2, &z[0], &k3[0], n);
+        math::assign(z, y + h * k3);
+        f.eval(x + h, &z[0], &k4[0], n);
 
         x += h;
-        y += (k1 + 2.0 * k2 + 2.0 * k3 + k4) / 6.0;
+        y += h6 * (k1 + 2 * k2 + 2 * k3 + k4);
+        f.eval(x, &y[0], &p.dy[0], n);
     }
 
 private:
     typename ODE<T>::X h;
+    typename ODE<T>::Y k2;
+    typename ODE<T>::Y k3;
+    typename ODE<T>::Y k4;
+    typename ODE<T>::Y z;
+};
+
+// RK4 for states of dimension N known at compile time. The state is copied
+// into a std::array and the stages are kept in more of them on the stack,
+// so a short state stays in registers throughout the step. A right-hand side
+// of exactly the type F is called through F::eval, bound statically, so it
+// inlines into the stages with the dimension as a constant; any other goes
+// through the virtual call.
+template <typename T, size_t N, typename F>
+class RK4Integrator : public Integrator<T>
+{
+public:
+    RK4Integrator(typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP)
+    :   h(step)
+    {/* Do nothing. */}
+
+    typename ODE<T>::X step() const { return h; }
+
+    void advance(typename ODE<T>::Point& p, ODEFun<T> const& f)
+    {
+        if (p.y.size() != N)
+            throw std::invalid_argument("RK4Integrator::advance(): State \
+dimension does not match the integrator.");
+
+        if (typeid(f) == typeid(F))
+            stages(p, KernelEval(static_cast<F const&>(f)));
+        else stages(p, VirtualEval(f));
+    }
+
+private:
+    struct KernelEval
+    {
+        F const& f;
+        KernelEval(F const& f) : f(f) {/* Do nothing. */}
+        void operator () (typename ODE<T>::X x, T const* y, T* dy) const
+        { f.F::eval(x, y, dy, N); }
+    };
+
+    struct VirtualEval
+    {
+        ODEFun<T> const& f;
+        VirtualEval(ODEFun<T> const& f) : f(f) {/* Do nothing. */}
+        void operator () (typename ODE<T>::X x, T const* y, T* dy) const
+        { f.eval(x, y, dy, N); }
+    };
+
+    typename ODE<T>::X h;
+
+    template <typename E>
+    void stages(typename ODE<T>::Point& p, E const& eval) const
+    {
+        typename ODE<T>::X& x = p.x;
+        T const h2 = h / 2;
+        T const h6 = h / 6;
+
+        typename ODE<T, N>::Y y, k1, k2, k3, k4, z;
+        std::copy(p.y.begin(), p.y.end(), y.begin());
+        if (p.dy.size() != N)
+        {
+            p.dy.resize(N);
+            eval(x, &y[0], &k1[0]);
+        }
+        else std::copy(p.dy.begin(), p.dy.end(), k1.begin());
+
+        for (size_t i = 0; i < N; ++i) z[i] = y[i] + h2 * k1[i];
+        eval(x + h2, &z[0], &k2[0]);
+        for (size_t i = 0; i < N; ++i) z[i] = y[i] + h2 * k2[i];
+        eval(x + h2, &z[0], &k3[0]);
+        for (size_t i = 0; i < N; ++i) z[i] = y[i] + h * k3[i];
+        eval(x + h, &z[0], &k4[0]);
+
+        x += h;
+        for (size_t i = 0; i < N; ++i)
+            y[i] += h6 * (k1[i] + 2 * k2[i] + 2 * k3[i] + k4[i]);
+        eval(x, &y[0], &k1[0]);
+        std::copy(y.begin(), y.end(), p.y.begin());
+        std::copy(k1.begin(), k1.end(), p.dy.begin());
+    }
 };
 
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                         DormandPrinceIntegrator                            **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Embedded Runge-Kutta 5(4) pair with local error control. Each call to
+// advance() performs one accepted step, whose size is picked by the
+// controller, so p.x moves by a varying amount. The step passed to the
+// constructor is the largest step the controller may take. The last stage
+// of an accepted step is the derivative at the new point, which is left in
+// p.dy and reused as the first stage of the next step.
+template <typename T>
+class DormandPrinceIntegrator : public Integrator<T>
+{
+public:
+    static T const DEFAULT_ABS_TOL;
+    static T const DEFAULT_REL_TOL;
+
+    DormandPrinceIntegrator(
+        typename ODE<T>::X  maxStep = Integrator<T>::DEFAULT_STEP,
+        T                   absTol  = DEFAULT_ABS_TOL,
+        T                   relTol  = DEFAULT_REL_TOL
+    );
+    void advance(typename ODE<T>::Point& p, ODEFun<T> const& f);
+    typename ODE<T>::X step() const { return hMax; }
+    bool adaptive() const { return true; }
+
+private:
+    static T const SAFETY;
+    static T const MIN_FACTOR;
+    static T const MAX_FACTOR;
+    static T const BETA;
+
+    typename ODE<T>::X  hMax;
+    typename ODE<T>::X  h;
+    T const             absTol;
+    T const             relTol;
+    T                   errOld;
+    typename ODE<T>::Y  k1;
+    typename ODE<T>::Y  k2;
+    typename ODE<T>::Y  k3;
+    typename ODE<T>::Y  k4;
+    typename ODE<T>::Y  k5;
+    typename ODE<T>::Y  k6;
+    typename ODE<T>::Y  k7;
+    typename ODE<T>::Y  z;
+
+    T errorNorm(typename ODE<T>::Y const& y) const;
+};
+
+template <typename T> T const DormandPrinceIntegrator<T>::DEFAULT_ABS_TOL = 1e-6;
+template <typename T> T const DormandPrinceIntegrator<T>::DEFAULT_REL_TOL = 1e-6;
+template <typename T> T const DormandPrinceIntegrator<T>::SAFETY          = 0.9;
+template <typename T> T const DormandPrinceIntegrator<T>::MIN_FACTOR      = 0.2;
+template <typename T> T const DormandPrinceIntegrator<T>::MAX_FACTOR      = 5.0;
+template <typename T> T const DormandPrinceIntegrator<T>::BETA            = 0.04;
+
+template <typename T> inline
+DormandPrinceIntegrator<T>::DormandPrinceIntegrator(
+    typename ODE<T>::X  maxStep,
+    T                   absTol,
+    T                   relTol
+)
+:   hMax(maxStep),
+    h(maxStep),
+    absTol(absTol),
+    relTol(relTol),
+    errOld(1e-4)
+{/* Do nothing. */}
+
+template <typename T>
+void
+DormandPrinceIntegrator<T>::advance(
+    typename ODE<T>::Point& p,
+    ODEFun<T> const&        f
+)
+{
+    typename ODE<T>::X& x = p.x;
+    typename ODE<T>::Y& y = p.y;
+    size_t const n = y.size();
+
+    // k1 and k7 trade storage with p.dy, so they are checked separately.
+    if (z.size() != n || k1.size() != n || k7.size() != n)
+    {
+        k1.resize(n);
+        k2.resize(n);
+        k3.resize(n);
+        k4.resize(n);
+        k5.resize(n);
+        k6.resize(n);
+        k7.resize(n);
+        z.resize(n);
+    }
+
+    if (p.dy.size() == n) k1.swap(p.dy);
+    else f.eval(x, &y[0], &k1[0], n);
+
+    for (;;)
+    {
+        math::assign(z, y + h * (1.0 / 5.0 * k1));
+        f.eval(x + h / 5, &z[0], &k2[0], n);
+        math::assign(z, y + h * (3.0 / 40.0 * k1 + 9.0 / 40.0 * k2));
+        f.eval(x + h * 3 / 10, &z[0], &k3[0], n);
+        math::assign(z, y + h * (44.0 / 45.0 * k1 - 56.0 / 15.0 * k2
+            + 32.0 / 9.0 * k3));
+        f.eval(x + h * 4 / 5, &z[0], &k4[0], n);
+        math::assign(z, y + h * (19372.0 / 6561.0 * k1
+            - 25360.0 / 2187.0 * k2 + 64448.0 / 6561.0 * k3
+            - 212.0 / 729.0 * k4));
+        f.eval(x + h * 8 / 9, &z[0], &k5[0], n);
+        math::assign(z, y + h * (9017.0 / 3168.0 * k1 - 355.0 / 33.0 * k2
+            + 46732.0 / 5247.0 * k3 + 49.0 / 176.0 * k4
+            - 5103.0 / 18656.0 * k5));
+        f.eval(x + h, &z[0], &k6[0], n);
+        math::assign(z, y + h * (35.0 / 384.0 * k1 + 500.0 / 1113.0 * k3
+            + 125.0 / 192.0 * k4 - 2187.0 / 6784.0 * k5
+            + 11.0 / 84.0 * k6));
+        f.eval(x + h, &z[0], &k7[0], n);
+
+        // Difference between the fifth and the embedded fourth order
+        // solution, stored in k2 which is no longer needed.
+        math::assign(k2, h * (71.0 / 57600.0 * k1 - 71.0 / 16695.0 * k3
+            + 71.0 / 1920.0 * k4 - 17253.0 / 339200.0 * k5
+            + 22.0 / 525.0 * k6 - 1.0 / 40.0 * k7));
+        T const err = errorNorm(y);
+
+        if (err <= 1)
+        {
+            x += h;
+            y.swap(z);
+            T const e = std::max(err, static_cast<T>(1e-4));
+            T factor = SAFETY * std::pow(errOld, BETA)
+                * std::pow(e, static_cast<T>(0.75) * BETA - static_cast<T>(0.2));
+            factor  = std::min(MAX_FACTOR, std::max(MIN_FACTOR, factor));
+            h       = std::min(hMax, h * factor);
+            errOld  = e;
+            p.dy.swap(k7);
+            return;
+        }
+
+        T const factor = std::max(MIN_FACTOR,
+            SAFETY * std::pow(err, static_cast<T>(-0.2)));
+        h *= factor;
+        if (x + h == x)
+        {
+            p.dy.clear();
+            throw std::runtime_error("DormandPrinceIntegrator::advance(): \
+Step size underflow.");
+        }
+    }
+}
+
+template <typename T>
+inline T
+DormandPrinceIntegrator<T>::errorNorm(typename ODE<T>::Y const& y) const
+{
+    size_t const n = y.size();
+    T sum = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        T const scale = absTol
+            + relTol * std::max(std::abs(y[i]), std::abs(z[i]));
+        sum += math::sq(k2[i] / scale);
+    }
+    return std::sqrt(sum / static_cast<T>(n));
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                          SymplecticIntegrator                              **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Base of splitting integrators for second order systems. The state is
+// assumed to hold positions in its first half and the matching velocities
+// in the second half. A drift updates only the positions, with
+// ODEFun::positionDerivative() when the function gives it, which for a
+// mechanical system is a copy of the velocities, and with eval() otherwise.
+// A kick updates only the velocities, with one evaluation of the
+// acceleration. As the acceleration may depend on the velocity (drag), it
+// is taken at the velocity predicted over pred with the acceleration of the
+// previous kick: the last kick of a Verlet step, predicted over the whole
+// kick, is then the adjoint of the first, taken as is, and the step stays
+// second order. For velocity independent forces every kick is exact. The
+// first kick may be given the derivative at its starting point, when
+// already known, to save its evaluation.
+template <typename T>
+class SymplecticIntegrator : public Integrator<T>
+{
+public:
+    typename ODE<T>::X step() const { return h; }
+
+protected:
+    SymplecticIntegrator(typename ODE<T>::X step);
+
+    void kick(typename ODE<T>::X x, typename ODE<T>::Y& y,
+        ODEFun<T> const& f, typename ODE<T>::X pred, typename ODE<T>::X dt,
+        typename ODE<T>::Y const* dy0 = NULL);
+    void drift(typename ODE<T>::X x, typename ODE<T>::Y& y,
+        ODEFun<T> const& f, typename ODE<T>::X dt);
+
+    typename ODE<T>::X h;
+
+private:
+    typename ODE<T>::Y dy;
+    typename ODE<T>::Y z;
+};
+
+template <typename T> inline
+SymplecticIntegrator<T>::SymplecticIntegrator(typename ODE<T>::X step)
+:   h(step)
+{/* Do nothing. */}
+
+// The acceleration of the kick is left in the second half of dy, for the
+// prediction of the next one.
+template <typename T>
+inline void
+SymplecticIntegrator<T>::kick(
+    typename ODE<T>::X      x,
+    typename ODE<T>::Y&     y,
+    ODEFun<T> const&        f,
+    typename ODE<T>::X      pred,
+    typename ODE<T>::X      dt,
+    typename ODE<T>::Y const* dy0
+)
+{
+    size_t const n = y.size();
+    if (z.size() != n)
+    {
+        dy.resize(n);
+        z.resize(n);
+    }
+    if (dy0 != NULL && dy0->size() == n)
+        std::copy(dy0->begin() + n / 2, dy0->end(), dy.begin() + n / 2);
+    else if (pred == 0) f.eval(x, &y[0], &dy[0], n);
+    else
+    {
+        std::copy(y.begin(), y.begin() + n / 2, z.begin());
+        for (size_t i = n / 2; i < n; ++i) z[i] = y[i] + pred * dy[i];
+        f.eval(x, &z[0], &dy[0], n);
+    }
+    for (size_t i = n / 2; i < n; ++i) y[i] += dt * dy[i];
+}
+
+template <typename T>
+inline void
+SymplecticIntegrator<T>::drift(
+    typename ODE<T>::X      x,
+    typename ODE<T>::Y&     y,
+    ODEFun<T> const&        f,
+    typename ODE<T>::X      dt
+)
+{
+    size_t const n = y.size();
+    if (z.size() != n)
+    {
+        dy.resize(n);
+        z.resize(n);
+    }
+    // The velocities go to z, as dy keeps the acceleration of the last kick.
+    if (!f.positionDerivative(x, &y[0], &z[0], n))
+        f.eval(x, &y[0], &z[0], n);
+    for (size_t i = 0; i < n / 2; ++i) y[i] += dt * z[i];
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                            VerletIntegrator                                **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Second order velocity Verlet (kick-drift-kick leapfrog). Drifts are
+// evaluated at the midpoint of their interval, which keeps explicitly
+// time-dependent position derivatives, like a driven anchor, second order.
+template <typename T>
+class VerletIntegrator : public SymplecticIntegrator<T>
+{
+public:
+    VerletIntegrator(typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP);
+    void advance(typename ODE<T>::Point& p, ODEFun<T> const& f);
+};
+
+template <typename T> inline
+VerletIntegrator<T>::VerletIntegrator(typename ODE<T>::X step)
+:   SymplecticIntegrator<T>(step)
+{/* Do nothing. */}
+
+template <typename T>
+inline void
+VerletIntegrator<T>::advance(typename ODE<T>::Point& p, ODEFun<T> const& f)
+{
+    typename ODE<T>::X const h = this->h;
+    this->kick (p.x        , p.y, f, 0    , h / 2, &p.dy);
+    this->drift(p.x + h / 2, p.y, f, h           );
+    this->kick (p.x + h    , p.y, f, h / 2, h / 2);
+    p.x += h;
+    p.dy.clear();
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                          ForestRuthIntegrator                              **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Fourth order Forest-Ruth (Yoshida) composition of three Verlet steps of
+// lengths theta * h, (1 - 2 * theta) * h and theta * h, with the adjacent
+// half kicks merged.
+template <typename T>
+class ForestRuthIntegrator : public SymplecticIntegrator<T>
+{
+public:
+    ForestRuthIntegrator(
+        typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP);
+    void advance(typename ODE<T>::Point& p, ODEFun<T> const& f);
+
+private:
+    static double const THETA;
+};
+
+template <typename T>
+double const ForestRuthIntegrator<T>::THETA
+    = 1.0 / (2.0 - 1.25992104989487316477);
+
+template <typename T> inline
+ForestRuthIntegrator<T>::ForestRuthIntegrator(typename ODE<T>::X step)
+:   SymplecticIntegrator<T>(step)
+{/* Do nothing. */}
+
+template <typename T>
+inline void
+ForestRuthIntegrator<T>::advance(
+    typename ODE<T>::Point& p,
+    ODEFun<T> const&        f
+)
+{
+    typename ODE<T>::X const h  = this->h;
+    typename ODE<T>::X const x  = p.x;
+    typename ODE<T>::X const a  = THETA * h;
+    typename ODE<T>::X const b  = (1 - 2 * THETA) * h;
+
+    this->kick (x                  , p.y, f, 0    , a / 2, &p.dy);
+    this->drift(x + a / 2          , p.y, f, a                  );
+    this->kick (x + a              , p.y, f, a / 2, (a + b) / 2 );
+    this->drift(x + a + b / 2      , p.y, f, b                  );
+    this->kick (x + a + b          , p.y, f, b / 2, (a + b) / 2 );
+    this->drift(x + a + b + a / 2  , p.y, f, a                  );
+    this->kick (x + h              , p.y, f, a / 2, a / 2       );
+    p.x += h;
+    p.dy.clear();
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                          RosenbrockIntegrator                              **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Linearly implicit, L-stable second order Rosenbrock method ROS2 (Verwer et
+// al.), for stiff problems. Each step solves two linear systems with
+// I - gamma * h * J, where J is the block tridiagonal Jacobian, in O(n). The
+// explicit time dependence of f is taken into account by a difference
+// quotient in x. The Jacobian is taken from ODEFun::jacobian() when the
+// function provides it.
+template <typename T>
+class RosenbrockIntegrator : public Integrator<T>
+{
+public:
+    RosenbrockIntegrator(
+        typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP);
+    void advance(typename ODE<T>::Point& p, ODEFun<T> const& f);
+    typename ODE<T>::X step() const { return h; }
+
+private:
+    static double const GAMMA;
+
+    typename ODE<T>::X  h;
+    BlockTridiagonal<T> J;
+    typename ODE<T>::Y  dy;
+    typename ODE<T>::Y  dt;
+    typename ODE<T>::Y  k1;
+    typename ODE<T>::Y  k2;
+    typename ODE<T>::Y  z;
+    typename ODE<T>::Y  dz;
+};
+
+template <typename T>
+double const RosenbrockIntegrator<T>::GAMMA = 1.0 + 0.70710678118654752440;
+
+template <typename T> inline
+RosenbrockIntegrator<T>::RosenbrockIntegrator(typename ODE<T>::X step)
+:   h(step)
+{/* Do nothing. */}
+
+template <typename T>
+void
+RosenbrockIntegrator<T>::advance(
+    typename ODE<T>::Point& p,
+    ODEFun<T> const&        f
+)
+{
+    typename ODE<T>::X& x = p.x;
+    typename ODE<T>::Y& y = p.y;
+    size_t const n = y.size();
+    T const gh = GAMMA * h;
+
+    if (k1.size() != n)
+    {
+        dy.resize(n);
+        dt.resize(n);
+        k1.resize(n);
+        k2.resize(n);
+        dz.resize(n);
+    }
+
+    if (p.dy.size() == n) dy.swap(p.dy);
+    else f.eval(x, &y[0], &dy[0], n);
+    p.dy.clear();
+    if (!f.jacobian(x, &y[0], n, J))
+        finiteDifferenceJacobian(f, x, y, dy, J, z, dz);
+    J.shiftedScale(-gh);
+    J.factor();
+
+    typename ODE<T>::X const delta = std::sqrt(
+        std::numeric_limits<T>::epsilon()) * std::max(std::abs(x), h);
+    f.eval(x + delta, &y[0], &dt[0], n);
+    for (size_t i = 0; i < n; ++i) dt[i] = gh * h * (dt[i] - dy[i]) / delta;
+
+    math::assign(k1, h * dy + dt);
+    J.solve(&k1[0]);
+
+    math::assign(z, y + k1);
+    f.eval(x + h, &z[0], &dz[0], n);
+    math::assign(k2, h * dz - 2 * k1 - dt);
+    J.solve(&k2[0]);
+
+    x += h;
+    y += 1.5 * k1 + 0.5 * k2;
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                            ModalIntegrator                                 **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Exponential integrator for chains like the pendulum: positions followed by
+// the matching velocities, node 0 driven and nodes 1, ..., n coupled by a
+// symmetric tridiagonal stiffness and a uniform linear damping. That linear
+// part, the Jacobian of f at rest, is diagonalized into normal modes, each a
+// damped oscillator propagated exactly by the exponential of its 2x2 matrix.
+// The remainder of f, the driver coupling and the quadratic drag, enters
+// through the second order exponential time differencing scheme ETD2RK (Cox
+// and Matthews), and the driven node through Heun's method. The step is thus
+// limited by the remainder rather than by the stiffest mode; without drag it
+// only has to resolve the driver.
+//
+// The modes take O(n^2) to build, by the eigensolver of
+// symmetric_tridiagonal.hpp, and are rebuilt whenever the linear part
+// changes, as when the equation is replaced. The Jacobian is taken from
+// ODEFun::jacobian() when the function provides it. The transforms between
+// nodes and modes make a step O(n^2) as well, against O(n) for the explicit
+// integrators, so it pays for steps many times longer than theirs. The
+// remainder is projected onto the modes skipping its zeros, which without
+// drag is all but the driver coupling, and the modal state is kept from
+// step to step, so that only the way back to the nodes costs O(n^2).
+template <typename T>
+class ModalIntegrator : public Integrator<T>
+{
+public:
+    ModalIntegrator(typename ODE<T>::X step = Integrator<T>::DEFAULT_STEP);
+    void advance(typename ODE<T>::Point& p, ODEFun<T> const& f);
+    typename ODE<T>::X step() const { return h; }
+
+private:
+    static int const TAYLOR_TERMS = 18;
+
+    // Propagators of a mode over a step: the exponential E of its linear part
+    // and h * phi1 and h * phi2 of it applied to a unit velocity forcing.
+    struct Mode
+    {
+        T E[2][2];
+        T phi1[2];
+        T phi2[2];
+    };
+
+    typename ODE<T>::X  h;
+    size_t              n;
+    // Stiffness of node k (1-based) on itself at k - 1, on node k + 1 at
+    // k - 1 of the off-diagonal, and the damping.
+    std::vector<T>      stiffness;
+    std::vector<T>      coupling;
+    T                   damping;
+    // Mode j, normalized, at j * n.
+    std::vector<T>      modes;
+    std::vector<Mode>   propagators;
+    BlockTridiagonal<T> J;
+    // Nodal state of the last step and its modal positions a and velocities
+    // b, valid while valid is set.
+    typename ODE<T>::Y  last;
+    std::vector<T>      a;
+    std::vector<T>      b;
+    bool                valid;
+    typename ODE<T>::Y  dy;
+    typename ODE<T>::Y  z;
+    typename ODE<T>::Y  dz;
+    std::vector<T>      r;
+    std::vector<T>      N0;
+    std::vector<T>      N1;
+    std::vector<size_t> nonzero;
+
+    bool linearize(typename ODE<T>::X x, typename ODE<T>::Y const& y,
+        ODEFun<T> const& f);
+    void build();
+    void remainder(T const* y, T const* Dy, T* r) const;
+    void project(T const* u, T* v);
+    void reconstruct(T const* va, T const* vb, T* ua, T* ub) const;
+};
+
+template <typename T> inline
+ModalIntegrator<T>::ModalIntegrator(typename ODE<T>::X step)
+:   h(step),
+    n(0),
+    damping(0),
+    valid(false)
+{/* Do nothing. */}
+
+template <typename T>
+void
+ModalIntegrator<T>::advance(typename ODE<T>::Point& p, ODEFun<T> const& f)
+{
+    typename ODE<T>::X const x = p.x;
+    typename ODE<T>::Y& y = p.y;
+    size_t const size = y.size();
+    size_t const m = size / 2;
+    if (size % 2 != 0 || m < 2)
+        throw std::invalid_argument("ModalIntegrator::advance(): State is \
+not a chain of positions and velocities.");
+
+    if (linearize(x, y, f)) build();
+    if (!valid || last != y)
+    {
+        project(&y[1], &a[0]);
+        project(&y[m + 1], &b[0]);
+    }
+
+    if (p.dy.size() == size) dy.swap(p.dy);
+    else f.eval(x, &y[0], &dy[0], size);
+    p.dy.clear();
+    remainder(&y[0], &dy[0], &r[0]);
+    project(&r[0], &N0[0]);
+
+    for (size_t j = 0; j < n; ++j)
+    {
+        Mode const& P = propagators[j];
+        T const aj = a[j];
+        T const bj = b[j];
+        a[j] = P.E[0][0] * aj + P.E[0][1] * bj + P.phi1[0] * N0[j];
+        b[j] = P.E[1][0] * aj + P.E[1][1] * bj + P.phi1[1] * N0[j];
+    }
+    z[0] = y[0] + h * dy[0];
+    z[m] = y[m] + h * dy[m];
+    reconstruct(&a[0], &b[0], &z[1], &z[m + 1]);
+
+    f.eval(x + h, &z[0], &dz[0], size);
+    remainder(&z[0], &dz[0], &r[0]);
+    project(&r[0], &N1[0]);
+
+    for (size_t j = 0; j < n; ++j)
+    {
+        Mode const& P = propagators[j];
+        T const dN = N1[j] - N0[j];
+        a[j] += P.phi2[0] * dN;
+        b[j] += P.phi2[1] * dN;
+    }
+    y[0] += h / 2 * (dy[0] + dz[0]);
+    y[m] += h / 2 * (dy[m] + dz[m]);
+    reconstruct(&a[0], &b[0], &y[1], &y[m + 1]);
+
+    p.x += h;
+    last = y;
+    valid = true;
+}
+
+// Reads the linear part of f off its Jacobian at rest, where the drag has no
+// linear term. Returns whether it differs from the one the modes were built
+// for.
+template <typename T>
+bool
+ModalIntegrator<T>::linearize(
+    typename ODE<T>::X          x,
+    typename ODE<T>::Y const&   y,
+    ODEFun<T> const&            f
+)
+{
+    size_t const size = y.size();
+    size_t const m = size / 2;
+    z.assign(y.begin(), y.begin() + m);
+    z.resize(size, 0);
+    if (!f.jacobian(x, &z[0], size, J))
+    {
+        dz.resize(size);
+        f.eval(x, &z[0], &dz[0], size);
+        finiteDifferenceJacobian(f, x, z, dz, J, dy, r);
+    }
+
+    bool changed = n != m - 1;
+    n = m - 1;
+    stiffness.resize(n);
+    coupling.resize(n - 1);
+    T meanDamping = 0;
+    T const tol = std::sqrt(std::numeric_limits<T>::epsilon());
+    for (size_t k = 1; k <= n; ++k)
+    {
+        if (J(k, m + k) != 1)
+            throw std::invalid_argument("ModalIntegrator::linearize(): The \
+equation is not of second order.");
+        T const s = J(m + k, k);
+        changed = changed || s != stiffness[k - 1];
+        stiffness[k - 1] = s;
+        if (k < n)
+        {
+            T const c = J(m + k, k + 1);
+            if (std::abs(c - J(m + k + 1, k))
+                > tol * (std::abs(c) + std::abs(J(m + k + 1, k))))
+                throw std::invalid_argument("ModalIntegrator::linearize(): \
+The stiffness is not symmetric.");
+            changed = changed || c != coupling[k - 1];
+            coupling[k - 1] = c;
+        }
+        meanDamping += J(m + k, m + k);
+    }
+    meanDamping /= static_cast<T>(n);
+    changed = changed || meanDamping != damping;
+    damping = meanDamping;
+    return changed;
+}
+
+// Diagonalizes the stiffness and computes the propagators of the modes. For
+// a mode of squared angular frequency w2 the exponential of the augmented
+//
+//         | 0       h       0   0 |
+//     W = | -w2 h   D h     h   0 |
+//         | 0       0       0   1 |
+//         | 0       0       0   0 |
+//
+// holds exp(h A) in its top left block and h phi1(h A) e2 and h phi2(h A) e2
+// in the next two columns (Sidje, Expokit), A being the 2x2 matrix of the
+// mode. It is computed by scaling and squaring a truncated Taylor series.
+template <typename T>
+void
+ModalIntegrator<T>::build()
+{
+    std::vector<double> d(n), e(n - 1);
+    for (size_t k = 0; k < n; ++k) d[k] = -stiffness[k];
+    for (size_t k = 0; k + 1 < n; ++k) e[k] = -coupling[k];
+    std::vector<double> const w2 = symmetricTridiagonalEigenvalues(d, e);
+
+    modes.resize(n * n);
+    propagators.resize(n);
+    std::vector<double> v(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        symmetricTridiagonalEigenvector(d, e, w2[j], &v[0]);
+        std::copy(v.begin(), v.end(), modes.begin() + j * n);
+
+        double W[4][4] = {
+            { 0,            h,              0, 0 },
+            { -w2[j] * h,   damping * h,    h, 0 },
+            { 0,            0,              0, 1 },
+            { 0,            0,              0, 0 }
+        };
+        double norm = 0;
+        for (int c = 0; c < 4; ++c)
+        {
+            double sum = 0;
+            for (int i = 0; i < 4; ++i) sum += std::abs(W[i][c]);
+            norm = std::max(norm, sum);
+        }
+        int squarings = 0;
+        while (norm > 0.5)
+        {
+            norm /= 2;
+            ++squarings;
+        }
+        double const scale = std::ldexp(1.0, -squarings);
+
+        double E[4][4], term[4][4], next[4][4];
+        for (int i = 0; i < 4; ++i)
+        for (int c = 0; c < 4; ++c)
+        {
+            W[i][c] *= scale;
+            E[i][c] = term[i][c] = i == c;
+        }
+        for (int k = 1; k <= TAYLOR_TERMS; ++k)
+        {
+            for (int i = 0; i < 4; ++i)
+            for (int c = 0; c < 4; ++c)
+            {
+                double sum = 0;
+                for (int l = 0; l < 4; ++l) sum += term[i][l] * W[l][c];
+                next[i][c] = sum / k;
+            }
+            for (int i = 0; i < 4; ++i)
+            for (int c = 0; c < 4; ++c)
+            {
+                term[i][c] = next[i][c];
+                E[i][c] += term[i][c];
+            }
+        }
+        for (int s = 0; s < squarings; ++s)
+        {
+            for (int i = 0; i < 4; ++i)
+            for (int c = 0; c < 4; ++c)
+            {
+                double sum = 0;
+                for (int l = 0; l < 4; ++l) sum += E[i][l] * E[l][c];
+                next[i][c] = sum;
+            }
+            std::copy(&next[0][0], &next[0][0] + 16, &E[0][0]);
+        }
+
+        Mode& P = propagators[j];
+        for (int i = 0; i < 2; ++i)
+        {
+            P.E[i][0]   = static_cast<T>(E[i][0]);
+            P.E[i][1]   = static_cast<T>(E[i][1]);
+            P.phi1[i]   = static_cast<T>(E[i][2]);
+            P.phi2[i]   = static_cast<T>(E[i][3]);
+        }
+    }
+
+    a.resize(n);
+    b.resize(n);
+    r.resize(n);
+    N0.resize(n);
+    N1.resize(n);
+    size_t const size = 2 * (n + 1);
+    dy.resize(size);
+    z.resize(size);
+    dz.resize(size);
+    valid = false;
+}
+
+// Velocity derivatives of nodes 1, ..., n at (y, Dy) less their linear part.
+// What is left of the linear part is rounding, cleared so that the
+// projection can skip it.
+template <typename T>
+void
+ModalIntegrator<T>::remainder(T const* y, T const* Dy, T* r) const
+{
+    size_t const m = n + 1;
+    T const eps = 4 * std::numeric_limits<T>::epsilon();
+    for (size_t k = 1; k <= n; ++k)
+    {
+        T const lin0 = stiffness[k - 1] * y[k];
+        T const lin1 = k > 1 ? coupling[k - 2] * y[k - 1] : 0;
+        T const lin2 = k < n ? coupling[k - 1] * y[k + 1] : 0;
+        T const lin3 = damping * y[m + k];
+        T const rk = Dy[m + k] - lin0 - lin1 - lin2 - lin3;
+        T const bound = eps * (std::abs(Dy[m + k]) + std::abs(lin0)
+            + std::abs(lin1) + std::abs(lin2) + std::abs(lin3));
+        r[k - 1] = std::abs(rk) <= bound ? 0 : rk;
+    }
+}
+
+// Modal coordinates v of the nodal vector u of nodes 1, ..., n.
+template <typename T>
+void
+ModalIntegrator<T>::project(T const* u, T* v)
+{
+    nonzero.clear();
+    for (size_t k = 0; k < n; ++k) if (u[k] != 0) nonzero.push_back(k);
+    for (size_t j = 0; j < n; ++j)
+    {
+        T const* mode = &modes[j * n];
+        T sum = 0;
+        if (4 * nonzero.size() < n)
+        {
+            for (size_t i = 0; i < nonzero.size(); ++i)
+                sum += mode[nonzero[i]] * u[nonzero[i]];
+        }
+        else for (size_t k = 0; k < n; ++k) sum += mode[k] * u[k];
+        v[j] = sum;
+    }
+}
+
+// Nodal vectors ua and ub of the modal coordinates va and vb, in a single
+// pass over the modes, which for long chains do not fit in the cache.
+template <typename T>
+void
+ModalIntegrator<T>::reconstruct(
+    T const*    va,
+    T const*    vb,
+    T*          ua,
+    T*          ub
+) const
+{
+    std::fill(ua, ua + n, static_cast<T>(0));
+    std::fill(ub, ub + n, static_cast<T>(0));
+    for (size_t j = 0; j < n; ++j)
+    {
+        T const* mode = &modes[j * n];
+        T const aj = va[j];
+        T const bj = vb[j];
+        for (size_t k = 0; k < n; ++k)
+        {
+            ua[k] += aj * mode[k];
+            ub[k] += bj * mode[k];
+        }
+    }
+}
+
 /*******************************************************************************
 ********************************************************************************
 **                                                                            **
@@ -145,12 +1237,34 @@ private:
 ********************************************************************************
 *******************************************************************************/
 
+// The solution is computed ahead of the consumer into a Trajectory. The
+// lookahead is given in units of x: the producer stops once the buffered
+// points span that much, and start() sizes the trajectory for the dimension
+// of the initial condition and enough steps of the integrator to cover the
+// lookahead, within memory limits. By default every step of the integrator
+// is published; with an output interval set, the producer integrates as
+// many steps as it takes to cover the interval and publishes only the last
+// one, so the traffic follows the consumer's needs rather than the step
+// size. Besides the consumer calling eval(), secondary readers, like a
+// recorder or an analyser, may attach to the stream and read the published
+// points without integrating them again; see Trajectory. Each call to eval()
+// tells the producer its argument, so that when the consumer jumps ahead the
+// producer integrates up to it without publishing the points in between,
+// unless a lossless reader is attached, and the consumer drops the stale
+// ones in a single step. The equation and
+// the integrator may be replaced while running; the solution then carries on
+// from its state at the last argument of eval(). Between two
+// buffered points it is interpolated by the cubic Hermite polynomial
+// matching the values and derivatives at both ends, so the points may be
+// much sparser than linear interpolation would need.
 template <typename T>
 class ODESolution
 {
 public:
     typedef std::pair<typename ODE<T>::X, typename ODE<T>::X> Range;
 
+    static typename ODE<T>::X const DEFAULT_LOOKAHEAD;
+
     ODESolution(typename ODE<T>::X x = 0,
 #       ifdef Q_CC_GNU
             typename ODE<T>::Y const& y = typename ODE<T>::Y(1, 0),
@@ -166,11 +1280,23 @@ public:
     void setInitialCondition(typename ODE<T>::Point const& p);
     void setEquation(ODEFun<T>* f);
     void setIntegrator(Integrator<T>* integrator);
+    void setLookahead(typename ODE<T>::X lookahead);
+    void setOutputInterval(typename ODE<T>::X interval);
 
     typename ODE<T>::Y operator () (typename ODE<T>::X x);
     typename ODE<T>::Y eval(typename ODE<T>::X x);
+    typename ODE<T>::X tryEval(typename ODE<T>::X x, typename ODE<T>::Y& y,
+        unsigned long time);
+
+    int     attachReader(bool lossy = false);
+    void    detachReader(int reader);
+    bool    read(int reader, typename ODE<T>::Point& p);
+    size_t  droppedPoints(int reader) const;
 
-    Range   bufferedRange();
+    typename ODE<T>::X  lookahead() const;
+    typename ODE<T>::X  outputInterval() const;
+    typename ODE<T>::X  bufferedTime();
+    Range               bufferedRange();
     void    start();
     void    stop();
     void    pause();
@@ -178,7 +1304,15 @@ public:
     bool    buffering() const;
 
 private:
-    class PointSpawner : public Spawner<typename ODE<T>::Point>
+    typedef typename Trajectory<T>::Row         Row;
+    typedef typename Trajectory<T>::ConstRow    ConstRow;
+
+    static size_t const MIN_CAPACITY        = 16;
+    static size_t const MAX_CAPACITY        = 1 << 16;
+    static size_t const MAX_BUFFER_BYTES    = 32 << 20;
+
+    // Publishes the last point first, then the points of the integration.
+    class PointSpawner : public Spawner<Row>
     {
     public:
         PointSpawner(typename ODE<T>::Point const& lastPoint
@@ -189,23 +1323,54 @@ private:
         void setLastPoint(typename ODE<T>::Point const& lastPoint);
         void setF(ODEFun<T>* f);
         void setIntegrator(Integrator<T>* integrator);
+        void setInterval(typename ODE<T>::X interval);
+        void setTarget(typename ODE<T>::X target);
+        void interrupt();
+        Integrator<T> const* integrator() const;
+        typename ODE<T>::X interval() const;
 
-        typename ODE<T>::Point spawn();
+        Row  spawn();
+        void spawnInto(Row& row);
+        void derive(typename ODE<T>::Point& p) const;
     
     private:
+        // Wall time in milliseconds a spawn may integrate before it
+        // publishes what it has, however far behind the target.
+        static qint64 const SPAWN_TIME = 10;
+        // Steps between two looks at the clock, which may take longer than
+        // a step of a short chain.
+        static unsigned int const SPAWN_CHECK_STEPS = 16;
+
         typename ODE<T>::Point  m_lastPoint;
+        bool                    m_published;
+        typename ODE<T>::X      m_interval;
+        // Written by the consumer, read by the producer.
+        std::atomic<typename ODE<T>::X> m_target;
+        // Set by the consumer to cut the current spawn short, cleared with
+        // the next last point.
+        std::atomic<bool>       m_interrupted;
         ODEFun<T>*              m_f;
         Integrator<T>*          m_integrator;
     };
 
     PointSpawner                    m_spawner;
-    Buffer<typename ODE<T>::Point>  m_buffer;
+    Buffer<Row, Trajectory<T> >     m_buffer;
     typename ODE<T>::X              m_lastArg;
-    typename ODE<T>::Point          m_beg;
-    typename ODE<T>::Point          m_end;
+    typename ODE<T>::X              m_lookahead;
     typename ODE<T>::Point          m_initialCondition;
+    // The point the producer started from, last time it was started.
+    typename ODE<T>::Point          m_origin;
+
+    size_t capacityFor(size_t dimension) const;
+    void rebase(ODEFun<T>* f, Integrator<T>* integrator);
+    void announce(typename ODE<T>::X x);
+    void interpolate(ConstRow const& beg, ConstRow const& end,
+        typename ODE<T>::X x, typename ODE<T>::Y& y) const;
 };
 
+template <typename T>
+typename ODE<T>::X const ODESolution<T>::DEFAULT_LOOKAHEAD = 0.25;
+
 template <typename T> inline
 ODESolution<T>::ODESolution(
     typename ODE<T>::X          x,
@@ -215,6 +1380,7 @@ ODESolution<T>::ODESolution(
 )
 :   m_spawner(typename ODE<T>::Point(x, y), f, integrator),
     m_buffer(&m_spawner),
+    m_lookahead(DEFAULT_LOOKAHEAD),
     m_initialCondition(x, y)
 {
     if (f != NULL) start();
@@ -228,6 +1394,7 @@ ODESolution<T>::ODESolution(
 )
 :   m_spawner(p, f, integrator),
     m_buffer(&m_spawner),
+    m_lookahead(DEFAULT_LOOKAHEAD),
     m_initialCondition(p)
 {
     if (f != NULL) start();
@@ -251,24 +1418,52 @@ modify solution while bufering");
     m_initialCondition = p;
 }
 
+// While running, the new equation takes over at the last argument of
+// eval(). Calls must then be serialized with those of eval() and tryEval(),
+// as the canvas does with its flowMutex.
 template <typename T>
 inline void
 ODESolution<T>::setEquation(ODEFun<T>* f)
 {
-    if (m_buffer.running())
-        throw std::runtime_error("ODESolution::setEquation(): Cannot modify \
-solution while buffering.");
-    m_spawner.setF(f);
+    if (m_buffer.running()) rebase(f, NULL);
+    else m_spawner.setF(f);
 }
 
+// Like setEquation(), the integrator may be replaced while running, and the
+// trajectory is then resized for its steps.
 template <typename T>
 inline void
 ODESolution<T>::setIntegrator(Integrator<T>* integrator)
+{
+    if (m_buffer.running()) rebase(NULL, integrator);
+    else m_spawner.setIntegrator(integrator);
+}
+
+template <typename T>
+inline void
+ODESolution<T>::setLookahead(typename ODE<T>::X lookahead)
 {
     if (m_buffer.running())
-        throw std::runtime_error("ODESolution::setIntegrator(): Cannot modify \
+        throw std::runtime_error("ODESolution::setLookahead(): Cannot modify \
 solution while buffering.");
-    m_spawner.setIntegrator(integrator);
+    if (!(lookahead > 0))
+        throw std::invalid_argument("ODESolution::setLookahead(): Lookahead \
+must be positive.");
+    m_lookahead = lookahead;
+}
+
+// An interval of zero publishes every step.
+template <typename T>
+inline void
+ODESolution<T>::setOutputInterval(typename ODE<T>::X interval)
+{
+    if (m_buffer.running())
+        throw std::runtime_error("ODESolution::setOutputInterval(): Cannot \
+modify solution while buffering.");
+    if (interval < 0)
+        throw std::invalid_argument("ODESolution::setOutputInterval(): \
+Interval must not be negative.");
+    m_spawner.setInterval(interval);
 }
 
 template <typename T>
@@ -284,37 +1479,249 @@ ODESolution<T>::eval(typename ODE<T>::X x)
 smaller than in the last call and the initial argument.");
 
     m_lastArg = x;
-    while (m_end.x < x)
+    announce(x);
+    if (m_buffer.container().dropBefore(x) > 0) m_buffer.notifyProducer();
+    ConstRow end = m_buffer.peek(1);
+    while (*end.x < x)
+    {
+        m_buffer.pop();
+        end = m_buffer.peek(1);
+    }
+    typename ODE<T>::Y y;
+    interpolate(m_buffer.peek(), end, x, y);
+    return y;
+}
+
+// Like eval(), but waits for the producer at most time milliseconds, and
+// settles for the newest buffered state if it does not reach x by then, or
+// at once when paused. Returns how far behind x the state put in y is, zero
+// if it is the state at x. Later calls may ask for the arguments skipped
+// this way.
+template <typename T>
+typename ODE<T>::X
+ODESolution<T>::tryEval(
+    typename ODE<T>::X  x,
+    typename ODE<T>::Y& y,
+    unsigned long       time
+)
+{
+    if (x < m_lastArg)
+        throw std::invalid_argument("ODESolution::tryEval(): Argument must not \
+be smaller than in the last call and the initial argument.");
+
+    QElapsedTimer timer;
+    timer.start();
+    announce(x);
+    for (;;)
+    {
+        if (m_buffer.container().dropBefore(x) > 0) m_buffer.notifyProducer();
+        if (m_buffer.size() >= 2 && *m_buffer.peek(1).x >= x)
+        {
+            m_lastArg = x;
+            interpolate(m_buffer.peek(), m_buffer.peek(1), x, y);
+            return 0;
+        }
+        qint64 const elapsed = timer.elapsed();
+        if (elapsed >= static_cast<qint64>(time)
+            || !m_buffer.waitForSize(2, time - elapsed))
+            break;
+    }
+
+    // Nothing published since the start means the state is the origin.
+    if (m_buffer.empty())
+    {
+        y = m_origin.y;
+        return x - m_origin.x;
+    }
+    // The state may lie behind an argument already evaluated, which must not
+    // move the last argument back.
+    ConstRow const last = m_buffer.peek();
+    m_lastArg = std::max(m_lastArg, *last.x);
+    y.assign(last.y, last.y + m_buffer.container().dimension());
+    return x - *last.x;
+}
+
+// Lets the producer skip publishing the points before x, unless a lossless
+// reader wants to see them all.
+template <typename T>
+inline void
+ODESolution<T>::announce(typename ODE<T>::X x)
+{
+    if (!m_buffer.container().hasLosslessReaders()) m_spawner.setTarget(x);
+}
+
+// The cubic Hermite interpolant of the points beg and end at x.
+template <typename T>
+void
+ODESolution<T>::interpolate(
+    ConstRow const&     beg,
+    ConstRow const&     end,
+    typename ODE<T>::X  x,
+    typename ODE<T>::Y& y
+) const
+{
+    size_t const n = m_buffer.container().dimension();
+    if (x == *end.x)
     {
-        m_beg = m_end;
-        m_end = m_buffer.next();
+        y.assign(end.y, end.y + n);
+        return;
     }
 
-    return ((x - m_beg.x) * m_beg.y + (m_end.x - x) * m_end.y)
-        / (m_end.x - m_beg.x);
+    typename ODE<T>::X const h = *end.x - *beg.x;
+    T const t   = (x - *beg.x) / h;
+    T const t2  = t * t;
+    T const t3  = t2 * t;
+    T const a   = 2 * t3 - 3 * t2 + 1;
+    T const b   = 3 * t2 - 2 * t3;
+    T const c   = h * (t3 - 2 * t2 + t);
+    T const d   = h * (t3 - t2);
+    y.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        y[i] = a * beg.y[i] + b * end.y[i] + c * beg.dy[i] + d * end.dy[i];
+}
+
+template <typename T> inline int
+ODESolution<T>::attachReader(bool lossy)
+{ return m_buffer.container().attachReader(lossy); }
+
+template <typename T> inline void
+ODESolution<T>::detachReader(int reader)
+{
+    m_buffer.container().detachReader(reader);
+    m_buffer.notifyProducer();
+}
+
+// Copies the next published point of the reader into p, returning false if
+// there is none yet. Does not block. Readers may go on reading while the
+// equation is replaced, and continue with the points of the new one; they
+// must not read while the solution is being started anew or given a new
+// integrator, either of which may reshape the storage.
+template <typename T>
+inline bool
+ODESolution<T>::read(int reader, typename ODE<T>::Point& p)
+{
+    size_t const n = m_buffer.container().dimension();
+    if (p.y.size() != n) p.y.resize(n);
+    if (p.dy.size() != n) p.dy.resize(n);
+    if (!m_buffer.container().read(reader, p.x, &p.y[0], &p.dy[0]))
+        return false;
+    m_buffer.notifyProducer();
+    return true;
+}
+
+template <typename T> inline size_t
+ODESolution<T>::droppedPoints(int reader) const
+{ return m_buffer.container().dropped(reader); }
+
+template <typename T> inline typename ODE<T>::X
+ODESolution<T>::lookahead() const { return m_lookahead; }
+
+template <typename T> inline typename ODE<T>::X
+ODESolution<T>::outputInterval() const { return m_spawner.interval(); }
+
+// Span of x buffered beyond the last evaluated argument. Does not block.
+template <typename T>
+inline typename ODE<T>::X
+ODESolution<T>::bufferedTime()
+{
+    if (m_buffer.empty()) return 0;
+    return std::max(*m_buffer.container().back().x - m_lastArg,
+        static_cast<typename ODE<T>::X>(0));
 }
 
 template <typename T>
 typename ODESolution<T>::Range
 ODESolution<T>::bufferedRange() 
 {
-    return Range(m_buffer.peek().x, m_buffer.peekLast().x);
+    return Range(*m_buffer.peek().x, *m_buffer.peekLast().x);
 }
 
 template <typename T>
 void
 ODESolution<T>::start() {
-    if (!m_buffer.buffering())
+    if (!m_buffer.running())
     {
-        m_lastArg   = m_initialCondition.x;
-        m_end       = m_initialCondition;
-        m_spawner.setLastPoint(m_initialCondition);
+        size_t const n = m_initialCondition.y.size();
+        m_lastArg = m_initialCondition.x;
+        m_origin = m_initialCondition;
+        m_buffer.container().reset(capacityFor(n), n);
+        m_buffer.container().setHorizon(m_lookahead);
+        m_spawner.setLastPoint(m_origin);
     }
     m_buffer.startBuffering();
 }
 
-template <typename T> inline void
-ODESolution<T>::stop() { m_buffer.stop(); }
+// Points of the given dimension the trajectory needs to span the lookahead,
+// within MAX_BUFFER_BYTES. The points are at least a step or the output
+// interval apart, except for an adaptive integrator publishing every step,
+// whose steps may be far below its largest: it gets all the bytes allow and
+// is bounded by the horizon alone.
+template <typename T>
+size_t
+ODESolution<T>::capacityFor(size_t dimension) const
+{
+    size_t const maxCapacity = std::max(MIN_CAPACITY, std::min(MAX_CAPACITY,
+        MAX_BUFFER_BYTES / ((2 * dimension + 1) * sizeof(T))));
+    Integrator<T> const* integrator = m_spawner.integrator();
+    typename ODE<T>::X const interval = m_spawner.interval();
+    if (integrator->adaptive() && interval == 0) return maxCapacity;
+
+    typename ODE<T>::X const steps
+        = m_lookahead / std::max(integrator->step(), interval) + 2;
+    return steps >= maxCapacity
+        ? maxCapacity
+        : std::max(MIN_CAPACITY, static_cast<size_t>(std::ceil(steps)));
+}
+
+// Restarts the producer from the state at the last argument of eval() with
+// f and the integrator, where not NULL, replacing the current ones. Does not
+// wait for the producer: if that state is not buffered yet, because the
+// producer lags behind, the solution carries on from the newest published
+// point instead, and nothing published since the start means the origin.
+// The points buffered beyond the state are dropped along with the
+// generation of the producer that computed them, and so are the unread
+// points of the secondary readers. The trajectory is resized for the new
+// integrator, as by start(). A paused solution stays paused.
+template <typename T>
+void
+ODESolution<T>::rebase(ODEFun<T>* f, Integrator<T>* integrator)
+{
+    bool const buffering = m_buffer.buffering();
+    // Leaves the newest point before the last argument at the front, so the
+    // front is the newest published point unless the next one reaches it.
+    m_buffer.container().dropBefore(m_lastArg);
+    if (m_buffer.size() >= 2 && *m_buffer.peek(1).x >= m_lastArg)
+    {
+        typename ODE<T>::Y y;
+        interpolate(m_buffer.peek(), m_buffer.peek(1), m_lastArg, y);
+        m_origin = typename ODE<T>::Point(m_lastArg, y);
+    }
+    else if (!m_buffer.empty())
+    {
+        ConstRow const last = m_buffer.peek();
+        m_origin = typename ODE<T>::Point(*last.x, typename ODE<T>::Y(last.y,
+            last.y + m_buffer.container().dimension()));
+    }
+    m_origin.dy.clear();
+
+    m_spawner.interrupt();
+    m_buffer.stop();
+    if (f != NULL) m_spawner.setF(f);
+    if (integrator != NULL) m_spawner.setIntegrator(integrator);
+    size_t const n = m_buffer.container().dimension();
+    m_buffer.container().reset(capacityFor(n), n);
+    m_spawner.setLastPoint(m_origin);
+    m_buffer.startBuffering();
+    if (!buffering) m_buffer.pause();
+}
+
+template <typename T>
+inline void
+ODESolution<T>::stop()
+{
+    m_spawner.interrupt();
+    m_buffer.stop();
+}
 
 template <typename T> inline void
 ODESolution<T>::pause() { m_buffer.pause(); }
@@ -340,6 +1747,10 @@ ODESolution<T>::PointSpawner::PointSpawner(
     Integrator<T>* integrator
 )
 :   m_lastPoint(lastPoint),
+    m_published(false),
+    m_interval(0),
+    m_target(lastPoint.x),
+    m_interrupted(false),
     m_f(f),
     m_integrator(integrator)
 {/* Do nothing. */}
@@ -358,6 +1769,9 @@ ODESolution<T>::PointSpawner::setLastPoint(
 )
 {
     m_lastPoint = lastPoint;
+    m_published = false;
+    m_target.store(lastPoint.x, std::memory_order_relaxed);
+    m_interrupted.store(false, std::memory_order_relaxed);
 }
 
 template <typename T>
@@ -383,11 +1797,101 @@ ODESolution<T>::PointSpawner::setIntegrator(Integrator<T>* integrator)
 }
 
 template <typename T>
-inline typename ODE<T>::Point
+inline void
+ODESolution<T>::PointSpawner::setInterval(typename ODE<T>::X interval)
+{
+    m_interval = interval;
+}
+
+// The consumer's latest argument. Points that a step would not carry up to it
+// are of no use to the consumer, so they are not published.
+template <typename T>
+inline void
+ODESolution<T>::PointSpawner::setTarget(typename ODE<T>::X target)
+{
+    m_target.store(target, std::memory_order_relaxed);
+}
+
+// Makes the spawn in progress return as soon as the step at hand is done,
+// for the buffer to drop it, so that stopping does not wait for the producer
+// to catch up. Stays in effect until the next call to setLastPoint().
+template <typename T>
+inline void
+ODESolution<T>::PointSpawner::interrupt()
+{
+    m_interrupted.store(true, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline Integrator<T> const*
+ODESolution<T>::PointSpawner::integrator() const
+{
+    return m_integrator;
+}
+
+template <typename T>
+inline typename ODE<T>::X
+ODESolution<T>::PointSpawner::interval() const
+{
+    return m_interval;
+}
+
+// The returned view points into the spawner and is valid until the next
+// call. A spawn integrates for about SPAWN_TIME at most, give or take
+// SPAWN_CHECK_STEPS steps, before it publishes the point reached, so that a
+// producer slower than the consumer still shows progress rather than
+// chasing a target that keeps moving away.
+template <typename T>
+inline typename ODESolution<T>::Row
 ODESolution<T>::PointSpawner::spawn()
 {
-    m_integrator->advance(m_lastPoint, *m_f);
-    return m_lastPoint;
+    if (m_published)
+    {
+        // Half a step of slack keeps rounding in x from costing an extra
+        // step when the interval is a multiple of the step.
+        typename ODE<T>::X const target = m_lastPoint.x + m_interval
+            - m_integrator->step() / 2;
+        QElapsedTimer timer;
+        timer.start();
+        unsigned int steps = 0;
+        do m_integrator->advance(m_lastPoint, *m_f);
+        while ((m_lastPoint.x < target || m_lastPoint.x
+                + m_integrator->step()
+                < m_target.load(std::memory_order_relaxed))
+            && !m_interrupted.load(std::memory_order_relaxed)
+            && (++steps % SPAWN_CHECK_STEPS != 0
+                || timer.elapsed() < SPAWN_TIME));
+    }
+    derive(m_lastPoint);
+    m_published = true;
+    Row const row = { &m_lastPoint.x, &m_lastPoint.y[0], &m_lastPoint.dy[0] };
+    return row;
+}
+
+// Copies the spawned point into the row, which must be of the dimension of
+// the point.
+template <typename T>
+inline void
+ODESolution<T>::PointSpawner::spawnInto(Row& row)
+{
+    Row const p = spawn();
+    size_t const n = m_lastPoint.y.size();
+    *row.x = *p.x;
+    std::copy(p.y, p.y + n, row.y);
+    std::copy(p.dy, p.dy + n, row.dy);
+}
+
+// Fills in the derivative of p if it is not known.
+template <typename T>
+inline void
+ODESolution<T>::PointSpawner::derive(typename ODE<T>::Point& p) const
+{
+    size_t const n = p.y.size();
+    if (m_f != NULL && p.dy.size() != n)
+    {
+        p.dy.resize(n);
+        m_f->eval(p.x, &p.y[0], &p.dy[0], n);
+    }
 }
 
 } // namespace jg
@@ -1,4 +1,8 @@
+#include <map>
+#include <stdexcept>
+
 #include "pendulum.hpp"
+#include "symmetric_tridiagonal.hpp"
 
 namespace jg {
 
@@ -25,4 +29,71 @@ Pendulum::positions() const
     return result;
 }
 
+// The symmetric tridiagonal matrix of the linearized pendulum of n segments,
+// its diagonal d and off-diagonal e, whose eigenvalues are the lambdas of
+// resonanceEigenvalues().
+static void
+pendulumMatrix(size_t n, std::vector<double>& d, std::vector<double>& e)
+{
+    d.resize(n);
+    e.resize(n == 0 ? 0 : n - 1);
+    for (size_t k = 1; k <= n; ++k)
+    {
+        d[k - 1] = 2.0 * (n - k) + 1;
+        if (k < n) e[k - 1] = -static_cast<double>(n - k);
+    }
+}
+
+PendulumModes::PendulumModes(size_t segmentCnt, size_t modeCnt)
+:   m_segmentCnt(segmentCnt),
+    m_modeCnt(modeCnt),
+    m_modes(segmentCnt * modeCnt),
+    m_correction(segmentCnt, 1)
+{
+    if (modeCnt < 1 || modeCnt > segmentCnt)
+        throw std::invalid_argument("PendulumModes::PendulumModes(): Mode \
+count out of range.");
+
+    size_t const n = segmentCnt;
+    std::vector<double> d, e;
+    pendulumMatrix(n, d, e);
+    std::vector<double> const& lambdas = resonanceEigenvalues(n);
+    for (size_t j = 0; j < modeCnt; ++j)
+    {
+        double* const u = &m_modes[j * n];
+        symmetricTridiagonalEigenvector(d, e, lambdas[j], u);
+        double c = 0;
+        for (size_t i = 0; i < n; ++i) c += u[i];
+        for (size_t i = 0; i < n; ++i) m_correction[i] -= c * u[i];
+    }
+}
+
+// Map nodes never move, so the references handed out stay valid as more
+// segment counts are added.
+static QMutex                                   resonanceMutex;
+static std::map<size_t, std::vector<double> >   resonanceCache;
+
+std::vector<double> const&
+resonanceEigenvalues(size_t segmentCnt)
+{
+    QMutexLocker locker(&resonanceMutex);
+    std::map<size_t, std::vector<double> >::iterator it
+        = resonanceCache.find(segmentCnt);
+    if (it != resonanceCache.end()) return it->second;
+
+    std::vector<double> d, e;
+    pendulumMatrix(segmentCnt, d, e);
+    return resonanceCache[segmentCnt] = symmetricTridiagonalEigenvalues(d, e);
+}
+
+double
+resonanceFrequency(size_t segmentCnt, double length, size_t k)
+{
+    std::vector<double> const& lambdas = resonanceEigenvalues(segmentCnt);
+    if (k < 1 || k > lambdas.size())
+        throw std::out_of_range("resonanceFrequency(): No such resonance.");
+    return std::sqrt(lambdas[k - 1] * PendulumODEFun<double>::GRAV_ACCEL
+        / length);
+}
+
 } // namespace jg
@@ -145,7 +145,13 @@ Pendulum::setDeflections(std::vector<float> const& d) { m_deflection = d; }
 ********************************************************************************
 *******************************************************************************/
 
-template <typename T>
+// The right-hand side of the pendulum equation. With N == DYNAMIC_SIZE the
+// segment count follows from the size of the state, otherwise it is N and
+// all loops below have a constant trip count.
+template <typename T, size_t W> class PendulumEnsemble;
+template <typename T> class ReducedPendulumODEFun;
+
+template <typename T, size_t N = DYNAMIC_SIZE>
 class PendulumODEFun : public ODEFun<T>
 {
 public:
@@ -168,31 +174,92 @@ public:
         L(viscosity * math::PI * radius * radius / mass),
         Q(0.5 * DRAG_COEFF * math::PI * radius * radius * density / mass)
     {/* Do nothing. */}
+
+    template <size_t M>
+    explicit PendulumODEFun(PendulumODEFun<T, M> const& f)
+    :   C(f.C),
+        mass(f.mass),
+        angFrequency(f.angFrequency),
+        amplitude(f.amplitude),
+        L(f.L),
+        Q(f.Q)
+    {/* Do nothing. */}
     
-    typename ODE<T>::Y
-    operator () (typename ODE<T>::X x, typename ODE<T>::Y const& y) const
+    void
+    eval(typename ODE<T>::X x, T const* y, T* Dy, size_t size) const
     {
-        int const n = y.size() / 2 - 1;
-        typename ODE<T>::Y Dy(y.size(), 0);
-        Dy[0] = amplitude * angFrequency * std::cos(angFrequency * x);
-        for (int k = 1; k < n; ++k)
+        if (N != DYNAMIC_SIZE && size != 2 * (N + 1))
+            throw std::invalid_argument("PendulumODEFun::eval(): State \
+dimension does not match the segment count.");
+
+        // The coefficients are copied to locals, as the stores to Dy could
+        // otherwise alias them and force a reload on every node, and the
+        // weights n - k are counted down in T rather than converted.
+        int const n = N == DYNAMIC_SIZE ? size / 2 - 1 : N;
+        T const C = this->C;
+        T const L = this->L;
+        T const Q = this->Q;
+        Dy[0]       = amplitude * angFrequency * std::cos(angFrequency * x);
+        Dy[n + 1]   = 0;
+        T w = static_cast<T>(n - 1);
+        for (int k = 1; k < n; ++k, w -= 1)
         {
-            Dy[k]           = y[n + k + 1];
-            Dy[n + k + 1]   = C * ( static_cast<T>(n - k + 1) * y[k - 1]
-                            + static_cast<T>(n - k) * y[k + 1]
-                            - static_cast<T>(2 * (n - k) + 1) * y[k] )
-                            - y[n + k + 1] * (L + (y[n + k + 1] < 0 ? -Q : Q)
-                            * y[n + k + 1]);
-
+            T const v       = y[n + k + 1];
+            Dy[k]           = v;
+            Dy[n + k + 1]   = C * ( (w + 1) * y[k - 1] + w * y[k + 1]
+                            - (2 * w + 1) * y[k] )
+                            - v * (L + Q * std::abs(v));
         }
         Dy[n]           = y[2 * n + 1];
         Dy[2 * n + 1]   = C * (y[n - 1] - y[n])
-                        - y[2 * n + 1] * (L + (y[2 * n + 1] < 0 ? -Q : Q)
-                        * y[2 * n + 1]);
-        return Dy;
+                        - y[2 * n + 1] * (L + Q * std::abs(y[2 * n + 1]));
+    }
+
+    bool
+    jacobian(typename ODE<T>::X, T const* y, size_t size,
+        BlockTridiagonal<T>& J) const
+    {
+        if (N != DYNAMIC_SIZE && size != 2 * (N + 1))
+            throw std::invalid_argument("PendulumODEFun::jacobian(): State \
+dimension does not match the segment count.");
+
+        int const n = N == DYNAMIC_SIZE ? size / 2 - 1 : N;
+        int const m = n + 1;
+        if (J.nodeCnt() != static_cast<size_t>(m)) J.resize(m);
+        else J.setZero();
+        for (int k = 1; k <= n; ++k)
+        {
+            J(k, m + k)         = 1;
+            J(m + k, k - 1)     = C * static_cast<T>(n - k + 1);
+            J(m + k, k)         = -C * static_cast<T>(2 * (n - k) + 1);
+            if (k < n)
+                J(m + k, k + 1) = C * static_cast<T>(n - k);
+            // d/dv of v * (L + Q * |v|).
+            J(m + k, m + k)     = -(L + 2 * Q * std::abs(y[m + k]));
+        }
+        return true;
+    }
+
+    // The driven anchor, then the velocities of the nodes.
+    bool
+    positionDerivative(typename ODE<T>::X x, T const* y, T* Dq,
+        size_t size) const
+    {
+        if (N != DYNAMIC_SIZE && size != 2 * (N + 1))
+            throw std::invalid_argument("PendulumODEFun::positionDerivative(\
+): State dimension does not match the segment count.");
+
+        size_t const m = size / 2;
+        Dq[0] = amplitude * angFrequency * std::cos(angFrequency * x);
+        std::copy(y + m + 1, y + 2 * m, Dq + 1);
+        return true;
     }
 
 private:
+    template <typename, size_t> friend class PendulumODEFun;
+    template <typename, size_t> friend class PendulumEnsemble;
+    template <typename> friend class ReducedPendulumODEFun;
+
     T const C;
     T const mass;
     T const angFrequency;
@@ -201,8 +268,491 @@ private:
     T const Q;
 };
 
-template <typename T> T const PendulumODEFun<T>::GRAV_ACCEL = 9.81;
-template <typename T> T const PendulumODEFun<T>::DRAG_COEFF = 0.47;
+template <typename T, size_t N>
+T const PendulumODEFun<T, N>::GRAV_ACCEL = 9.81;
+template <typename T, size_t N>
+T const PendulumODEFun<T, N>::DRAG_COEFF = 0.47;
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                          Fixed-size dispatch                               **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Largest segment count for which the fixed-size kernels are instantiated.
+size_t const MAX_FIXED_SEGMENT_CNT = 16;
+
+template <typename T, size_t N>
+struct PendulumKernels
+{
+    static ODEFun<T>*
+    equation(PendulumODEFun<T> const& f, size_t segmentCnt)
+    {
+        if (segmentCnt == N) return new PendulumODEFun<T, N>(f);
+        return PendulumKernels<T, N - 1>::equation(f, segmentCnt);
+    }
+
+    static Integrator<T>*
+    rk4Integrator(size_t segmentCnt, typename ODE<T>::X step)
+    {
+        if (segmentCnt == N)
+            return new RK4Integrator<T, 2 * (N + 1), PendulumODEFun<T, N> >(
+                step);
+        return PendulumKernels<T, N - 1>::rk4Integrator(segmentCnt, step);
+    }
+};
+
+template <typename T>
+struct PendulumKernels<T, 0>
+{
+    static ODEFun<T>*
+    equation(PendulumODEFun<T> const& f, size_t)
+    { return new PendulumODEFun<T>(f); }
+
+    static Integrator<T>*
+    rk4Integrator(size_t, typename ODE<T>::X step)
+    { return new RK4Integrator<T>(step); }
+};
+
+// Returns a copy of f specialized for segmentCnt segments when that count
+// is at most MAX_FIXED_SEGMENT_CNT, or a plain copy of f otherwise.
+template <typename T>
+inline ODEFun<T>*
+newPendulumODEFun(PendulumODEFun<T> const& f, size_t segmentCnt)
+{
+    return PendulumKernels<T, MAX_FIXED_SEGMENT_CNT>::equation(f, segmentCnt);
+}
+
+// Returns an RK4 integrator for the state of a pendulum of segmentCnt
+// segments, of fixed dimension whenever newPendulumODEFun() would be fixed.
+template <typename T>
+inline Integrator<T>*
+newRK4Integrator(size_t segmentCnt, typename ODE<T>::X step)
+{
+    return PendulumKernels<T, MAX_FIXED_SEGMENT_CNT>::rk4Integrator(
+        segmentCnt, step);
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                               Resonances                                   **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// The linearized pendulum of n segments and equal masses swings in modes
+// whose squared angular frequencies are lambda * g / length, the lambdas
+// being the eigenvalues of the symmetric tridiagonal matrix with the
+// diagonal 2 (n - k) + 1 and the off-diagonal -(n - k), k = 1, ..., n.
+// Returns them in increasing order. They are computed once per segment
+// count, in O(n^2), and kept for the life of the program; the reference
+// stays valid all along. Safe to call from any thread.
+std::vector<double> const& resonanceEigenvalues(size_t segmentCnt);
+
+// Angular frequency of the k-th mode, k = 1, ..., segmentCnt, of a pendulum
+// of segmentCnt segments of the given length.
+double resonanceFrequency(size_t segmentCnt, double length, size_t k);
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                             PendulumModes                                  **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// The slowest modes of a pendulum of n segments: the first k eigenvectors of
+// the matrix of resonanceEigenvalues(), normalized, over nodes 1, ..., n.
+// They are orthonormal, so the modal coordinates of a nodal vector are its
+// dot products with them. Computed by inverse iteration in O(n k).
+//
+// A displacement x0 of the anchor pulls the whole chain along, to x0 at
+// every node at rest, a shape the slow modes alone render poorly. Its part
+// outside of them, the static correction, is carried along with the modes,
+// so that the fast modes follow the anchor quasi-statically rather than not
+// at all (the mode acceleration method of structural dynamics).
+class PendulumModes
+{
+public:
+    explicit PendulumModes(size_t segmentCnt = 1, size_t modeCnt = 1);
+
+    size_t          segmentCnt() const;
+    size_t          modeCnt() const;
+    bool            complete() const;
+    double          eigenvalue(size_t j) const;
+    double const*   mode(size_t j) const;
+    double const*   correction() const;
+
+    template <typename T> void project(T const* y, T* z) const;
+    template <typename T> void reconstruct(T const* z, T* y) const;
+
+private:
+    size_t              m_segmentCnt;
+    size_t              m_modeCnt;
+    std::vector<double> m_modes;
+    std::vector<double> m_correction;
+};
+
+inline size_t
+PendulumModes::segmentCnt() const { return m_segmentCnt; }
+
+inline size_t
+PendulumModes::modeCnt() const { return m_modeCnt; }
+
+// Whether these are all the modes, so that nothing is truncated.
+inline bool
+PendulumModes::complete() const { return m_modeCnt == m_segmentCnt; }
+
+inline double
+PendulumModes::eigenvalue(size_t j) const
+{ return resonanceEigenvalues(m_segmentCnt)[j]; }
+
+inline double const*
+PendulumModes::mode(size_t j) const { return &m_modes[j * m_segmentCnt]; }
+
+// Static correction per unit of anchor displacement: the vector of ones
+// less its projection onto the modes.
+inline double const*
+PendulumModes::correction() const { return &m_correction[0]; }
+
+// Reduced state z, the anchor followed by the modal coordinates and then
+// the same for the velocities, of the Galerkin projection of the nodal
+// state y. The static correction being orthogonal to the modes, it does not
+// change the modal coordinates.
+template <typename T>
+inline void
+PendulumModes::project(T const* y, T* z) const
+{
+    size_t const n = m_segmentCnt;
+    size_t const k = m_modeCnt;
+    z[0]        = y[0];
+    z[k + 1]    = y[n + 1];
+    for (size_t j = 0; j < k; ++j)
+    {
+        double const* u = mode(j);
+        double a = 0;
+        double b = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            a += u[i] * y[i + 1];
+            b += u[i] * y[n + i + 2];
+        }
+        z[j + 1]        = static_cast<T>(a);
+        z[k + j + 2]    = static_cast<T>(b);
+    }
+}
+
+// Nodal state y of the reduced state z, the deflections with the static
+// correction for the anchor. The reduced state does not know the velocity
+// of the anchor, so the velocities are those of the modes alone.
+template <typename T>
+inline void
+PendulumModes::reconstruct(T const* z, T* y) const
+{
+    size_t const n = m_segmentCnt;
+    size_t const k = m_modeCnt;
+    y[0]        = z[0];
+    y[n + 1]    = z[k + 1];
+    for (size_t i = 0; i < n; ++i)
+        y[i + 1] = z[0] * static_cast<T>(m_correction[i]);
+    std::fill(y + n + 2, y + 2 * n + 2, static_cast<T>(0));
+    for (size_t j = 0; j < k; ++j)
+    {
+        double const* u = mode(j);
+        T const a = z[j + 1];
+        T const b = z[k + j + 2];
+        for (size_t i = 0; i < n; ++i)
+        {
+            y[i + 1]        += a * static_cast<T>(u[i]);
+            y[n + i + 2]    += b * static_cast<T>(u[i]);
+        }
+    }
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                         ReducedPendulumODEFun                              **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Galerkin projection of the pendulum equation onto its k slowest modes, for
+// long chains whose response sits in the first few. The state is that of
+// PendulumModes::project(), laid out like the full one, positions first, so
+// every integrator applies. Stiffness and viscosity are diagonal in the
+// modes and the driver enters each mode through the first node, which costs
+// O(k) per evaluation; the drag is evaluated at the nodes, through the
+// reconstructed velocities, the static correction moving with the anchor,
+// which costs O(n k).
+//
+// The modes left out are the fast ones, so the reduced equation is also much
+// less stiff. errorEstimate() tells how much is lost. The reconstructed
+// motion misses the full equation by a residual force outside of the modes:
+// the acceleration of the static correction and the part of the full
+// right-hand side the projection drops, mostly drag. The modes left out
+// respond to it about statically, as long as the driver is slower than the
+// first of them, so the static response of the chain to the residual, one
+// tridiagonal solve, estimates the error of the deflections. It is that of
+// the forced response: free vibrations of the modes left out, set off by an
+// abrupt start and dying out with the damping, go unseen.
+template <typename T>
+class ReducedPendulumODEFun : public ODEFun<T>
+{
+public:
+    ReducedPendulumODEFun(
+        PendulumODEFun<T> const&    f,
+        PendulumModes const&        modes
+    );
+
+    void eval(typename ODE<T>::X x, T const* y, T* Dy, size_t size) const;
+    bool jacobian(typename ODE<T>::X x, T const* y, size_t size,
+        BlockTridiagonal<T>& J) const;
+    bool positionDerivative(typename ODE<T>::X x, T const* y, T* Dq,
+        size_t size) const;
+    T errorEstimate(typename ODE<T>::X x, T const* y) const;
+
+    PendulumModes const& modes() const { return m_modes; }
+
+private:
+    PendulumODEFun<T> const m_full;
+    PendulumModes const     m_modes;
+    std::vector<T>          m_omegaSq;
+    std::vector<T>          m_anchorCoupling;
+    std::vector<T>          m_basis;
+    std::vector<T>          m_correction;
+    // Nodal velocities and drag, kept to spare an allocation per evaluation.
+    mutable std::vector<T>  m_v;
+
+    void modeVelocities(T const* y) const;
+    void velocities(typename ODE<T>::X x, T const* y) const;
+    void drag(typename ODE<T>::X x, T const* y, T* D) const;
+};
+
+template <typename T>
+ReducedPendulumODEFun<T>::ReducedPendulumODEFun(
+    PendulumODEFun<T> const&    f,
+    PendulumModes const&        modes
+)
+:   m_full(f),
+    m_modes(modes),
+    m_omegaSq(modes.modeCnt()),
+    m_anchorCoupling(modes.modeCnt()),
+    m_basis(modes.modeCnt() * modes.segmentCnt()),
+    m_correction(modes.correction(), modes.correction() + modes.segmentCnt()),
+    m_v(modes.segmentCnt())
+{
+    size_t const n = modes.segmentCnt();
+    for (size_t j = 0; j < modes.modeCnt(); ++j)
+    {
+        double const* u = modes.mode(j);
+        m_omegaSq[j] = static_cast<T>(f.C * modes.eigenvalue(j));
+        m_anchorCoupling[j] = static_cast<T>(f.C * n * u[0]);
+        std::copy(u, u + n, m_basis.begin() + j * n);
+    }
+}
+
+// Nodal velocities of the modes of the reduced state y into m_v.
+template <typename T>
+inline void
+ReducedPendulumODEFun<T>::modeVelocities(T const* y) const
+{
+    size_t const n = m_modes.segmentCnt();
+    size_t const k = m_modes.modeCnt();
+    std::fill(m_v.begin(), m_v.end(), static_cast<T>(0));
+    for (size_t j = 0; j < k; ++j)
+    {
+        T const* u = &m_basis[j * n];
+        T const b = y[k + j + 2];
+        for (size_t i = 0; i < n; ++i) m_v[i] += b * u[i];
+    }
+}
+
+// Nodal velocities of the reduced state y at x into m_v, with those of the
+// static correction, which moves with the anchor.
+template <typename T>
+inline void
+ReducedPendulumODEFun<T>::velocities(typename ODE<T>::X x, T const* y) const
+{
+    size_t const n = m_modes.segmentCnt();
+    T const omega = m_full.angFrequency;
+    T const anchor = m_full.amplitude * omega * std::cos(omega * x);
+    modeVelocities(y);
+    for (size_t i = 0; i < n; ++i) m_v[i] += anchor * m_correction[i];
+}
+
+// Modal drag D of the reduced state y at x, -Q v |v| projected at the nodes.
+template <typename T>
+inline void
+ReducedPendulumODEFun<T>::drag(typename ODE<T>::X x, T const* y, T* D) const
+{
+    size_t const n = m_modes.segmentCnt();
+    size_t const k = m_modes.modeCnt();
+    velocities(x, y);
+    for (size_t i = 0; i < n; ++i) m_v[i] *= -m_full.Q * std::abs(m_v[i]);
+    for (size_t j = 0; j < k; ++j)
+    {
+        T const* u = &m_basis[j * n];
+        T sum = 0;
+        for (size_t i = 0; i < n; ++i) sum += u[i] * m_v[i];
+        D[j] = sum;
+    }
+}
+
+template <typename T>
+void
+ReducedPendulumODEFun<T>::eval(
+    typename ODE<T>::X  x,
+    T const*            y,
+    T*                  Dy,
+    size_t              size
+) const
+{
+    size_t const k = m_modes.modeCnt();
+    if (size != 2 * (k + 1))
+        throw std::invalid_argument("ReducedPendulumODEFun::eval(): State \
+dimension does not match the mode count.");
+
+    T const omega = m_full.angFrequency;
+    Dy[0]       = m_full.amplitude * omega * std::cos(omega * x);
+    Dy[k + 1]   = 0;
+    if (m_full.Q != 0) drag(x, y, Dy + k + 2);
+    else std::fill(Dy + k + 2, Dy + 2 * k + 2, static_cast<T>(0));
+    for (size_t j = 0; j < k; ++j)
+    {
+        Dy[j + 1]       = y[k + j + 2];
+        Dy[k + j + 2]  += m_anchorCoupling[j] * y[0]
+                        - m_omegaSq[j] * y[j + 1]
+                        - m_full.L * y[k + j + 2];
+    }
+}
+
+// Only the part within the band: the drag couples all modes and the anchor
+// reaches every one of them, of which only the diagonal of the drag and the
+// anchor's reach into the first mode are kept. The drag is linearized about
+// the velocities of the modes alone, the static correction being left to the
+// driver, so at rest the Jacobian is the linear part and does not move with
+// x, and what is dropped is the driver coupling alone.
+template <typename T>
+bool
+ReducedPendulumODEFun<T>::jacobian(
+    typename ODE<T>::X,
+    T const*            y,
+    size_t              size,
+    BlockTridiagonal<T>& J
+) const
+{
+    size_t const n = m_modes.segmentCnt();
+    size_t const k = m_modes.modeCnt();
+    if (size != 2 * (k + 1))
+        throw std::invalid_argument("ReducedPendulumODEFun::jacobian(): \
+State dimension does not match the mode count.");
+
+    size_t const m = k + 1;
+    if (J.nodeCnt() != m) J.resize(m);
+    else J.setZero();
+    if (m_full.Q != 0) modeVelocities(y);
+    J(m + 1, 0) = m_anchorCoupling[0];
+    for (size_t j = 0; j < k; ++j)
+    {
+        T dragDiag = 0;
+        if (m_full.Q != 0)
+        {
+            T const* u = &m_basis[j * n];
+            for (size_t i = 0; i < n; ++i)
+                dragDiag += u[i] * u[i] * std::abs(m_v[i]);
+        }
+        J(j + 1, m + j + 1)     = 1;
+        J(m + j + 1, j + 1)     = -m_omegaSq[j];
+        J(m + j + 1, m + j + 1) = -(m_full.L + 2 * m_full.Q * dragDiag);
+    }
+    return true;
+}
+
+// The driven anchor, then the velocities of the modes.
+template <typename T>
+bool
+ReducedPendulumODEFun<T>::positionDerivative(
+    typename ODE<T>::X  x,
+    T const*            y,
+    T*                  Dq,
+    size_t              size
+) const
+{
+    size_t const k = m_modes.modeCnt();
+    if (size != 2 * (k + 1))
+        throw std::invalid_argument("ReducedPendulumODEFun::\
+positionDerivative(): State dimension does not match the mode count.");
+
+    T const omega = m_full.angFrequency;
+    Dq[0] = m_full.amplitude * omega * std::cos(omega * x);
+    std::copy(y + k + 2, y + 2 * k + 2, Dq + 1);
+    return true;
+}
+
+// Estimated error of the nodal deflections, in the 2-norm, of the reduced
+// state y at x against the full equation. O(n k). Zero with all the modes.
+template <typename T>
+T
+ReducedPendulumODEFun<T>::errorEstimate(
+    typename ODE<T>::X  x,
+    T const*            y
+) const
+{
+    size_t const n = m_modes.segmentCnt();
+    size_t const k = m_modes.modeCnt();
+    if (m_modes.complete()) return 0;
+
+    // The full right-hand side at the reconstructed state.
+    size_t const size = 2 * (n + 1);
+    std::vector<T> full(size);
+    std::vector<T> Dfull(size);
+    m_modes.reconstruct(y, &full[0]);
+    T const omega = m_full.angFrequency;
+    T const anchorVelocity = m_full.amplitude * omega * std::cos(omega * x);
+    T const anchorAccel
+        = -m_full.amplitude * omega * omega * std::sin(omega * x);
+    for (size_t i = 0; i < n; ++i)
+        full[n + i + 2] += anchorVelocity * m_correction[i];
+    m_full.eval(x, &full[0], &Dfull[0], size);
+
+    // Residual force outside of the modes.
+    std::vector<T> r(Dfull.begin() + n + 2, Dfull.end());
+    for (size_t j = 0; j < k; ++j)
+    {
+        T const* u = &m_basis[j * n];
+        T c = 0;
+        for (size_t i = 0; i < n; ++i) c += u[i] * r[i];
+        for (size_t i = 0; i < n; ++i) r[i] -= c * u[i];
+    }
+    for (size_t i = 0; i < n; ++i) r[i] -= anchorAccel * m_correction[i];
+
+    // Static response, solving C M e = r. Eliminating from the tip, the
+    // pivots of M come out as n - i in row i and the multipliers all as -1.
+    for (size_t i = n - 1; i-- > 0;) r[i] += r[i + 1];
+    T sq = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        T const pivot = static_cast<T>(n - i);
+        if (i > 0) r[i] += pivot * r[i - 1];
+        r[i] /= pivot;
+        sq += r[i] * r[i];
+    }
+    return std::sqrt(sq) / m_full.C;
+}
+
+// Returns the reduced model of f on the given modes, or the full one of
+// newPendulumODEFun() when the modes are complete.
+template <typename T>
+inline ODEFun<T>*
+newPendulumODEFun(PendulumODEFun<T> const& f, PendulumModes const& modes)
+{
+    if (modes.complete()) return newPendulumODEFun(f, modes.segmentCnt());
+    return new ReducedPendulumODEFun<T>(f, modes);
+}
 
 } // namespace jg
 
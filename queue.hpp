@@ -1,23 +1,54 @@
 #ifndef JG_QUEUE_HPP
 #define JG_QUEUE_HPP
 
+#include <atomic>
 #include <stdexcept>
+#include <utility>
 
 namespace jg {
 
+// Ring buffer that one producer thread and one consumer thread may use
+// concurrently without locking. The push functions and full() belong to the
+// producer; front(), back(), at(), the pop functions, clear() and empty() to the
+// consumer. size() may be called by either and is exact only when the other
+// side is idle. The capacity may be changed only while neither side is
+// active.
+//
+// The elements live in place in a contiguous array and are never destroyed
+// while the queue exists; a popped slot is overwritten by a later push. For
+// elements owning storage, like vectors, pushing by copy and popping with
+// popInto() therefore recycle that storage, and a steady stream of equally
+// sized elements allocates nothing. There is deliberately no push by move,
+// which would free the slot's storage in favour of the argument's.
+// beginPush() gives the producer the slot to fill in place, which endPush()
+// then publishes; this is the way to build an element without allocating.
+//
+// The indices grow without bound and are reduced modulo the capacity on
+// access. The index written by the consumer and the one written by the
+// producer are kept a cache line apart, each next to the side's own cached
+// copy of the other index, so the sides only touch each other's line when
+// the cached value no longer tells them whether they may proceed.
 template <typename T>
 class Queue
 {
 public:
     static size_t const DEFAULT_CAPACITY = 128;
 
+    typedef T&          Reference;
+    typedef T const&    ConstReference;
+
     explicit Queue(size_t capacity = DEFAULT_CAPACITY);
     ~Queue();
 
     T const&    front() const;
     T const&    back() const;
+    T const&    at(size_t i) const;
     void        push(T const& item);
+    T&          beginPush();
+    void        endPush();
     void        pop();
+    void        popInto(T& item);
+    bool        tryPop(T& item);
     void        clear();
     size_t      size() const;
     size_t      capacity() const;
@@ -26,21 +57,29 @@ public:
     bool        full() const;
 
 private:
-    T**     m_storage;
-    size_t  m_capacity;
-    size_t  m_size;
-    size_t  m_oldestPos;
-    size_t  m_latestPos;
-    size_t  m_newCapacity;
+    static size_t const CACHE_LINE_SIZE = 64;
+
+    T*                  m_storage;
+    size_t              m_capacity;
+    char                m_storagePad[CACHE_LINE_SIZE];
+
+    std::atomic<size_t> m_head;         // Written by the consumer.
+    mutable size_t      m_tailCache;
+    char                m_headPad[CACHE_LINE_SIZE];
+
+    std::atomic<size_t> m_tail;         // Written by the producer.
+    mutable size_t      m_headCache;
+    char                m_tailPad[CACHE_LINE_SIZE];
 };
 
 template <typename T> inline
 Queue<T>::Queue(size_t capacity)
 :   m_storage(NULL),
-    m_size(0),
-    m_oldestPos(0),
-    m_latestPos(capacity - 1),
-    m_newCapacity(0)
+    m_capacity(0),
+    m_head(0),
+    m_tailCache(0),
+    m_tail(0),
+    m_headCache(0)
 {
     setCapacity(capacity);
 }
@@ -48,11 +87,7 @@ Queue<T>::Queue(size_t capacity)
 template <typename T> inline
 Queue<T>::~Queue()
 {
-    if (m_storage != NULL)
-    {
-        clear();
-        delete[] m_storage;
-    }
+    delete[] m_storage;
 }
 
 template <typename T>
@@ -61,30 +96,58 @@ Queue<T>::front() const
 {
     if (empty())
         throw std::range_error("Queue::front(): Looking up empty container.");
-    else return *m_storage[m_oldestPos];
+    else return m_storage[m_head.load(std::memory_order_relaxed) % m_capacity];
 }
 
 template <typename T>
 inline T const&
 Queue<T>::back() const
 {
-    if (empty())
+    m_tailCache = m_tail.load(std::memory_order_acquire);
+    if (m_tailCache == m_head.load(std::memory_order_relaxed))
         throw std::range_error("Queue::back(): Looking up empty container.");
-    else return *m_storage[m_latestPos];
+    else return m_storage[(m_tailCache - 1) % m_capacity];
+}
+
+// Element i places behind the front.
+template <typename T>
+inline T const&
+Queue<T>::at(size_t i) const
+{
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    if (m_tailCache - head <= i)
+    {
+        m_tailCache = m_tail.load(std::memory_order_acquire);
+        if (m_tailCache - head <= i)
+            throw std::range_error("Queue::at(): Index out of range.");
+    }
+    return m_storage[(head + i) % m_capacity];
 }
 
 template <typename T>
 inline void
 Queue<T>::push(T const& item)
+{
+    beginPush() = item;
+    endPush();
+}
+
+template <typename T>
+inline T&
+Queue<T>::beginPush()
 {
     if (full())
-        throw std::range_error("Queue::push(): Pushing to a full container.");
-    else
-    {
-        m_latestPos = (m_latestPos + 1) % m_capacity;
-        m_storage[m_latestPos] = new T(item);
-        ++m_size;
-    }
+        throw std::range_error("Queue::beginPush(): Pushing to a full \
+container.");
+    else return m_storage[m_tail.load(std::memory_order_relaxed) % m_capacity];
+}
+
+template <typename T>
+inline void
+Queue<T>::endPush()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
 }
 
 template <typename T> inline
@@ -95,30 +158,58 @@ Queue<T>::pop()
         throw std::range_error("Queue::pop(): Popping an empty container.");
     else
     {
-        delete m_storage[m_oldestPos];
-        m_oldestPos = (m_oldestPos + 1) % m_capacity;
-        --m_size;
-        if (m_size < m_newCapacity) setCapacity(m_newCapacity);
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
     }
 }
 
+// Pops the front element into item by swapping, so the slot takes over the
+// former contents of item for reuse.
 template <typename T>
 inline void
-Queue<T>::clear()
+Queue<T>::popInto(T& item)
 {
-    while (!empty()) pop();
+    if (empty())
+        throw std::range_error("Queue::popInto(): Popping an empty \
+container.");
+    else
+    {
+        size_t const head = m_head.load(std::memory_order_relaxed);
+        using std::swap;
+        swap(item, m_storage[head % m_capacity]);
+        m_head.store(head + 1, std::memory_order_release);
+    }
 }
 
-template <typename T> inline size_t
-Queue<T>::size() const { return m_size; }
+template <typename T>
+inline bool
+Queue<T>::tryPop(T& item)
+{
+    if (empty()) return false;
+    popInto(item);
+    return true;
+}
+
+template <typename T>
+inline void
+Queue<T>::clear()
+{
+    m_head.store(m_tail.load(std::memory_order_acquire),
+        std::memory_order_release);
+}
 
 template <typename T>
 inline size_t
-Queue<T>::capacity() const
+Queue<T>::size() const
 {
-    return (m_newCapacity == 0 ? m_capacity : m_newCapacity);
+    // The head is read first, so it cannot overtake the tail.
+    size_t const head = m_head.load(std::memory_order_acquire);
+    return m_tail.load(std::memory_order_acquire) - head;
 }
 
+template <typename T> inline size_t
+Queue<T>::capacity() const { return m_capacity; }
+
 template <typename T>
 inline void
 Queue<T>::setCapacity(size_t capacity)
@@ -127,16 +218,15 @@ Queue<T>::setCapacity(size_t capacity)
         throw std::invalid_argument("Queue::setCapacity(): Capacity must be \
 greater than zero.");
 
-    if (capacity < m_size)
-    {
-        m_newCapacity = capacity;
-        return;
-    }
-    
-    T** newStorage;
+    size_t const size = this->size();
+    if (capacity < size)
+        throw std::invalid_argument("Queue::setCapacity(): Capacity must not \
+be smaller than the size.");
+
+    T* newStorage;
     try
     {
-        newStorage = new T*[capacity];
+        newStorage = new T[capacity];
     }
     catch(...)
     {
@@ -144,33 +234,38 @@ greater than zero.");
 storage.");
     }
 
-    if (!empty())
-    {
-        if (m_latestPos < m_oldestPos)
-        {
-            std::copy(m_storage + m_oldestPos, m_storage + m_capacity,
-                newStorage);
-            std::copy(m_storage, m_storage + m_latestPos + 1,
-                newStorage + m_capacity - m_oldestPos);
-        }
-        else
-        {
-            std::copy(m_storage + m_oldestPos, m_storage + m_latestPos + 1,
-                newStorage);
-        }
-    }
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i)
+        newStorage[i] = std::move(m_storage[(head + i) % m_capacity]);
 
     delete[] m_storage;
     m_storage       = newStorage;
     m_capacity      = capacity;
-    m_newCapacity   = 0;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(size, std::memory_order_relaxed);
+    m_tailCache     = size;
+    m_headCache     = 0;
 }
 
-template <typename T> inline bool
-Queue<T>::empty() const { return size() <= 0; }
+template <typename T>
+inline bool
+Queue<T>::empty() const
+{
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    if (head != m_tailCache) return false;
+    m_tailCache = m_tail.load(std::memory_order_acquire);
+    return head == m_tailCache;
+}
 
-template <typename T> inline bool
-Queue<T>::full() const { return size() >=  capacity(); }
+template <typename T>
+inline bool
+Queue<T>::full() const
+{
+    size_t const tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_headCache < m_capacity) return false;
+    m_headCache = m_head.load(std::memory_order_acquire);
+    return tail - m_headCache >= m_capacity;
+}
 
 } // namespace jg
 
@@ -0,0 +1,140 @@
+#include <stdexcept>
+
+#include "scenario.hpp"
+
+namespace jg {
+
+Scenario::Scenario()
+:   segmentCnt(3),
+    modeCnt(0),
+    length(2),
+    mass(1),
+    radius(0.25),
+    angFrequency(20),
+    resonance(0),
+    amplitude(0),
+    viscosity(0),
+    density(0),
+    integrator(EULER),
+    precision(FLOAT),
+    step(1.0 / 512.0),
+    duration(10),
+    outputInterval(0.01)
+{/* Do nothing. */}
+
+Scenario
+Scenario::load(QString const& path)
+{
+    // QSettings takes a missing file for an empty one.
+    QFileInfo const info(path);
+    QSettings settings(path, QSettings::IniFormat);
+    if (!info.isFile() || !info.isReadable()
+        || settings.status() != QSettings::NoError)
+        throw std::runtime_error("Scenario::load(): Unable to read "
+            + path.toStdString() + ".");
+
+    Scenario scenario;
+    QStringList const keys = settings.allKeys();
+    for (int i = 0; i < keys.size(); ++i)
+    {
+        // Lists come back split at the commas.
+        QVariant const value = settings.value(keys[i]);
+        scenario.set(keys[i], value.userType() == QMetaType::QStringList
+            ? value.toStringList().join(",") : value.toString());
+    }
+    return scenario;
+}
+
+// Sets the parameter named by key, with or without its group, from its text
+// as in an ini file.
+void
+Scenario::set(QString const& key, QString const& value)
+{
+    QString const name = key.section('/', -1);
+    bool ok = true;
+    if (name == "segmentCnt")
+    {
+        int const n = value.toInt(&ok);
+        ok = ok && n > 0;
+        if (ok) segmentCnt = static_cast<size_t>(n);
+    }
+    else if (name == "modeCnt")
+    {
+        int const k = value.toInt(&ok);
+        ok = ok && k >= 0;
+        if (ok) modeCnt = static_cast<size_t>(k);
+    }
+    else if (name == "length")          length = value.toDouble(&ok);
+    else if (name == "mass")            mass = value.toDouble(&ok);
+    else if (name == "radius")          radius = value.toDouble(&ok);
+    else if (name == "angFrequency")
+    {
+        QString const text = value.trimmed();
+        if (text.startsWith("resonance:"))
+        {
+            int const k = text.section(':', 1).toInt(&ok);
+            ok = ok && k > 0;
+            if (ok) resonance = static_cast<size_t>(k);
+        }
+        else
+        {
+            angFrequency = text.toDouble(&ok);
+            resonance = 0;
+        }
+    }
+    else if (name == "amplitude")       amplitude = value.toDouble(&ok);
+    else if (name == "viscosity")       viscosity = value.toDouble(&ok);
+    else if (name == "density")         density = value.toDouble(&ok);
+    else if (name == "step")            step = value.toDouble(&ok);
+    else if (name == "duration")        duration = value.toDouble(&ok);
+    else if (name == "outputInterval")  outputInterval = value.toDouble(&ok);
+    else if (name == "deflections")
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        QStringList const items = value.split(',', Qt::SkipEmptyParts);
+#else
+        QStringList const items = value.split(',', QString::SkipEmptyParts);
+#endif
+        deflections.resize(items.size());
+        for (int i = 0; ok && i < items.size(); ++i)
+            deflections[i] = items[i].trimmed().toDouble(&ok);
+    }
+    else if (name == "integrator")
+    {
+        if      (value == "Euler"         ) integrator = EULER;
+        else if (value == "RK4"           ) integrator = RK4;
+        else if (value == "Dormand-Prince") integrator = DORMAND_PRINCE;
+        else if (value == "Verlet"        ) integrator = VERLET;
+        else if (value == "Forest-Ruth"   ) integrator = FOREST_RUTH;
+        else if (value == "Rosenbrock"    ) integrator = ROSENBROCK;
+        else if (value == "Modal"         ) integrator = MODAL;
+        else ok = false;
+    }
+    else if (name == "precision")
+    {
+        if      (value == "Float"   ) precision = FLOAT;
+        else if (value == "Double"  ) precision = DOUBLE;
+        else ok = false;
+    }
+    else throw std::invalid_argument("Scenario::set(): Unknown parameter "
+        + key.toStdString() + ".");
+
+    if (!ok || length <= 0 || mass <= 0 || step <= 0 || duration < 0
+        || outputInterval <= 0)
+        throw std::invalid_argument("Scenario::set(): Invalid value "
+            + value.toStdString() + " of " + key.toStdString() + ".");
+}
+
+// The angular frequency of the driver, that of the chosen resonance if any.
+double
+Scenario::driverFrequency() const
+{
+    if (resonance == 0) return angFrequency;
+    if (resonance > segmentCnt)
+        throw std::invalid_argument("Scenario::driverFrequency(): No \
+resonance " + QString::number(resonance).toStdString() + " of a pendulum of "
+            + QString::number(segmentCnt).toStdString() + " segments.");
+    return resonanceFrequency(segmentCnt, length, resonance);
+}
+
+} // namespace jg
@@ -0,0 +1,165 @@
+#ifndef JG_SCENARIO_HPP
+#define JG_SCENARIO_HPP
+
+#include <vector>
+
+#include <QtCore/QtCore>
+
+#include "pendulum.hpp"
+
+namespace jg {
+
+// Parameters of a simulation run without the GUI, read from an ini file
+// whose keys are the members below, grouped like the panels of the
+// interface:
+//
+//     [pendulum]
+//     segmentCnt   = 3
+//     length       = 2
+//     mass         = 1
+//     radius       = 0.25
+//     deflections  = 0, 0.1, 0.2, 0.3
+//     modeCnt      = 0
+//
+//     [driver]
+//     angFrequency = 20
+//     amplitude    = 0.1
+//
+//     [fluid]
+//     viscosity    = 1
+//     density      = 10
+//
+//     [integrator]
+//     integrator   = RK4
+//     precision    = Double
+//     step         = 0.001
+//
+//     [run]
+//     duration         = 10
+//     outputInterval   = 0.01
+//
+// Missing keys keep their defaults, those of the interface. The deflections
+// are of the anchor and the nodes, padded with zeros when fewer are given.
+// The angular frequency may also be given as resonance:k, the k-th resonance
+// of the pendulum, as in the interface; it is resolved when the equation is
+// made, so that it follows the segment count and length. A mode count below
+// the segment count simulates the reduced model on that many of the slowest
+// modes instead of the full one (see ReducedPendulumODEFun); 0, the
+// default, or any count from the segment count up keeps all of them. The
+// state is then that of the modes, PendulumModes::reconstruct() gives back
+// the nodes. Integrator and precision names are those of the interface.
+struct Scenario
+{
+    enum Integrator {
+        EULER,
+        RK4,
+        DORMAND_PRINCE,
+        VERLET,
+        FOREST_RUTH,
+        ROSENBROCK,
+        MODAL
+    };
+    enum Precision {
+        FLOAT,
+        DOUBLE
+    };
+
+    Scenario();
+
+    static Scenario load(QString const& path);
+
+    void    set(QString const& key, QString const& value);
+    double  driverFrequency() const;
+    bool    reduced() const;
+
+    size_t              segmentCnt;
+    size_t              modeCnt;
+    double              length;
+    double              mass;
+    double              radius;
+    std::vector<double> deflections;
+    double              angFrequency;
+    size_t              resonance;
+    double              amplitude;
+    double              viscosity;
+    double              density;
+    Integrator          integrator;
+    Precision           precision;
+    double              step;
+    double              duration;
+    double              outputInterval;
+
+    template <typename T> PendulumODEFun<T>     equation() const;
+    template <typename T> ODEFun<T>*            newEquation() const;
+    template <typename T> jg::Integrator<T>*    newIntegrator() const;
+    template <typename T> typename ODE<T>::Y    initialState() const;
+};
+
+inline bool
+Scenario::reduced() const { return modeCnt > 0 && modeCnt < segmentCnt; }
+
+// The equation of the full model, whatever the mode count.
+template <typename T>
+inline PendulumODEFun<T>
+Scenario::equation() const
+{
+    return PendulumODEFun<T>(
+        static_cast<T>(length),
+        static_cast<T>(mass),
+        static_cast<T>(radius),
+        static_cast<T>(driverFrequency()),
+        static_cast<T>(amplitude),
+        static_cast<T>(viscosity),
+        static_cast<T>(density)
+    );
+}
+
+template <typename T>
+inline ODEFun<T>*
+Scenario::newEquation() const
+{
+    PendulumODEFun<T> const f = equation<T>();
+    if (reduced())
+        return newPendulumODEFun(f, PendulumModes(segmentCnt, modeCnt));
+    return newPendulumODEFun(f, segmentCnt);
+}
+
+// The enum Integrator hides the class template in here, hence jg::.
+template <typename T>
+inline jg::Integrator<T>*
+Scenario::newIntegrator() const
+{
+    typename ODE<T>::X const h = static_cast<T>(step);
+    // The state of k modes is laid out as that of k segments.
+    size_t const stateCnt = reduced() ? modeCnt : segmentCnt;
+    switch (integrator)
+    {
+    case EULER:             return new EulerIntegrator<T>(h);
+    case RK4:               return newRK4Integrator<T>(stateCnt, h);
+    case DORMAND_PRINCE:    return new DormandPrinceIntegrator<T>(h);
+    case VERLET:            return new VerletIntegrator<T>(h);
+    case FOREST_RUTH:       return new ForestRuthIntegrator<T>(h);
+    case ROSENBROCK:        return new RosenbrockIntegrator<T>(h);
+    case MODAL:             return new ModalIntegrator<T>(h);
+    }
+    return NULL;
+}
+
+// Deflections first, then velocities, all of which start at zero. Those of
+// the modes for a reduced model.
+template <typename T>
+inline typename ODE<T>::Y
+Scenario::initialState() const
+{
+    typename ODE<T>::Y y(2 * (segmentCnt + 1), 0);
+    for (size_t i = 0; i <= segmentCnt && i < deflections.size(); ++i)
+        y[i] = static_cast<T>(deflections[i]);
+    if (!reduced()) return y;
+    typename ODE<T>::Y z(2 * (modeCnt + 1));
+    PendulumModes(segmentCnt, modeCnt).project(&y[0], &z[0]);
+    return z;
+}
+
+} // namespace jg
+
+#endif // JG_SCENARIO_HPP
@@ -9,6 +9,10 @@ class Spawner
 public:
     virtual T spawn() = 0; 
 
+    // Spawns into an existing item, which implementations may override to
+    // reuse the storage the item already owns.
+    virtual void spawnInto(T& item) { item = spawn(); }
+
     virtual ~Spawner() {/* Do nothing. */}
 };
 
@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "ensemble.hpp"
+#include "sweep.hpp"
+
+namespace jg {
+
+double const Sweep::STEADY_FRACTION = 0.25;
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                                 Measuring                                  **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Mechanical energy of the state y of a pendulum of n segments, relative to
+// the rest position. The anchor does not count, it is driven. The potential
+// is the one the linearized equation derives from: segment k is stretched
+// sideways against the weight of the n - k + 1 nodes below it.
+template <typename T>
+double
+pendulumEnergy(T const* y, size_t n, double mass, double C)
+{
+    double kinetic = 0;
+    double potential = 0;
+    for (size_t k = 1; k <= n; ++k)
+    {
+        double const v = y[n + 1 + k];
+        double const d = y[k] - y[k - 1];
+        kinetic     += v * v;
+        potential   += static_cast<double>(n - k + 1) * d * d;
+    }
+    return 0.5 * mass * (kinetic + C * potential);
+}
+
+// The metrics of a case, taken step by step. The tip deflection is needed
+// at every step, the whole state only in the steady state.
+class SweepMeter
+{
+public:
+    explicit SweepMeter(Scenario const& scenario);
+
+    bool            steady(double x) const;
+    template <typename T>
+    void            add(double x0, double x, T tip, T const* y);
+    Sweep::Result   result(double x) const;
+
+private:
+    size_t          n;
+    double          mass;
+    double          C;
+    double          steadyBeg;
+    double          lo;
+    double          hi;
+    Sweep::Result   sums;
+};
+
+SweepMeter::SweepMeter(Scenario const& scenario)
+:   n(scenario.segmentCnt),
+    mass(scenario.mass),
+    C(PendulumODEFun<double>::GRAV_ACCEL / scenario.length),
+    steadyBeg((1 - Sweep::STEADY_FRACTION) * scenario.duration),
+    lo(std::numeric_limits<double>::infinity()),
+    hi(-lo)
+{
+    Sweep::Result const zero = { 0, 0, 0, 0 };
+    sums = zero;
+}
+
+inline bool
+SweepMeter::steady(double x) const { return x > steadyBeg; }
+
+// Takes the step from x0 to x, which ended in the state y with the tip at
+// tip. y is only read in the steady state.
+template <typename T>
+inline void
+SweepMeter::add(double x0, double x, T tip, T const* y)
+{
+    sums.peakDeflection = std::max(sums.peakDeflection,
+        std::abs(static_cast<double>(tip)));
+    if (!steady(x)) return;
+    lo = std::min<double>(lo, tip);
+    hi = std::max<double>(hi, tip);
+    sums.energy += (x - std::max(x0, steadyBeg))
+        * pendulumEnergy(y, n, mass, C);
+}
+
+// The metrics of the run up to x, without the time.
+Sweep::Result
+SweepMeter::result(double x) const
+{
+    Sweep::Result r = sums;
+    if (steady(x))
+    {
+        r.steadyAmplitude = 0.5 * (hi - lo);
+        r.energy /= x - steadyBeg;
+    }
+    return r;
+}
+
+// Integrates the scenario step by step, measuring it on the way. A run that
+// fails, like an adaptive one whose step underflows or one driven at a
+// resonance the pendulum does not have, measures NaN. A reduced model is
+// measured on its reconstructed nodes. Nothing may throw out of here, as
+// that would take down the worker thread and the whole sweep with it.
+template <typename T>
+Sweep::Result
+measure(Scenario const& scenario)
+{
+    QElapsedTimer timer;
+    timer.start();
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+    Sweep::Result result = { 0, 0, 0, 0 };
+
+    ODEFun<T>* f = NULL;
+    Integrator<T>* integrator = NULL;
+    try
+    {
+        f = scenario.newEquation<T>();
+        ReducedPendulumODEFun<T> const* const reduced
+            = dynamic_cast<ReducedPendulumODEFun<T> const*>(f);
+        integrator = scenario.newIntegrator<T>();
+        typename ODE<T>::Point p(0, scenario.initialState<T>());
+        size_t const n = scenario.segmentCnt;
+        typename ODE<T>::Y nodes(2 * (n + 1));
+        SweepMeter meter(scenario);
+        while (p.x < scenario.duration)
+        {
+            double const x = p.x;
+            integrator->advance(p, *f);
+            if (reduced != NULL)
+                reduced->modes().reconstruct(&p.y[0], &nodes[0]);
+            T const* const y = reduced != NULL ? &nodes[0] : &p.y[0];
+            meter.add(x, p.x, y[n], y);
+        }
+        result = meter.result(p.x);
+    }
+    catch (std::exception&)
+    {
+        result.peakDeflection = result.steadyAmplitude = result.energy = nan;
+    }
+    delete f;
+    delete integrator;
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    return result;
+}
+
+// Integrates the scenarios together, as the lanes of a PendulumEnsemble,
+// measuring each on the way. They must be batched as by Sweep::tasks(), and
+// are each given an equal share of the time. As in measure(), a case whose
+// equation cannot be made measures NaN; its lane is left at rest.
+template <typename T>
+std::vector<Sweep::Result>
+measureEnsemble(std::vector<Scenario> const& scenarios)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Scenario const& first = scenarios[0];
+    size_t const n = first.segmentCnt;
+    PendulumEnsemble<T> ensemble(n, static_cast<T>(first.step));
+    std::vector<SweepMeter> meters;
+    std::vector<bool> failed(scenarios.size(), false);
+    for (size_t l = 0; l < scenarios.size(); ++l)
+    {
+        try
+        {
+            ensemble.setLane(l, scenarios[l].equation<T>(),
+                scenarios[l].initialState<T>());
+        }
+        catch (std::exception&)
+        {
+            failed[l] = true;
+        }
+        meters.push_back(SweepMeter(scenarios[l]));
+    }
+    typename ODE<T>::Y y(ensemble.dimension());
+    while (ensemble.x() < first.duration)
+    {
+        double const x0 = ensemble.x();
+        ensemble.advance();
+        double const x = ensemble.x();
+        for (size_t l = 0; l < meters.size(); ++l)
+        {
+            if (meters[l].steady(x)) ensemble.state(l, y);
+            meters[l].add(x0, x, ensemble.component(l, n), &y[0]);
+        }
+    }
+
+    std::vector<Sweep::Result> results(meters.size());
+    double const seconds = timer.nsecsElapsed() / 1e9 / meters.size();
+    for (size_t l = 0; l < meters.size(); ++l)
+    {
+        results[l] = meters[l].result(ensemble.x());
+        if (failed[l])
+        {
+            results[l].peakDeflection = results[l].steadyAmplitude
+                = results[l].energy = std::numeric_limits<double>::quiet_NaN();
+        }
+        results[l].seconds = seconds;
+    }
+    return results;
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                                SweepWorker                                 **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// The tasks dealt to a worker, which takes them from the front while the
+// others steal them from the back.
+struct SweepDeque
+{
+    QMutex              mutex;
+    std::deque<size_t>  tasks;
+};
+
+class SweepWorker : public QThread
+{
+public:
+    SweepWorker(
+        Sweep const&                                sweep,
+        std::vector<std::vector<size_t> > const&    tasks,
+        std::vector<SweepDeque*> const&             deques,
+        size_t                                      own,
+        std::vector<Sweep::Result>&                 results
+    );
+
+private:
+    Sweep const&                                sweep;
+    std::vector<std::vector<size_t> > const&    tasks;
+    std::vector<SweepDeque*> const&             deques;
+    size_t const                                own;
+    std::vector<Sweep::Result>&                 results;
+
+    bool take(size_t& t);
+    bool steal(size_t& t);
+    void run();
+};
+
+SweepWorker::SweepWorker(
+    Sweep const&                                sweep,
+    std::vector<std::vector<size_t> > const&    tasks,
+    std::vector<SweepDeque*> const&             deques,
+    size_t                                      own,
+    std::vector<Sweep::Result>&                 results
+)
+:   sweep(sweep),
+    tasks(tasks),
+    deques(deques),
+    own(own),
+    results(results)
+{/* Do nothing. */}
+
+bool
+SweepWorker::take(size_t& t)
+{
+    SweepDeque& d = *deques[own];
+    QMutexLocker locker(&d.mutex);
+    if (d.tasks.empty()) return false;
+    t = d.tasks.front();
+    d.tasks.pop_front();
+    return true;
+}
+
+// Tasks are never added, so once a round over all deques finds nothing,
+// there is nothing left to do.
+bool
+SweepWorker::steal(size_t& t)
+{
+    for (size_t i = 1; i < deques.size(); ++i)
+    {
+        SweepDeque& d = *deques[(own + i) % deques.size()];
+        QMutexLocker locker(&d.mutex);
+        if (d.tasks.empty()) continue;
+        t = d.tasks.back();
+        d.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+// Each case has its own slot in the results, so they need no locking.
+void
+SweepWorker::run()
+{
+    size_t t;
+    while (take(t) || steal(t))
+    {
+        std::vector<size_t> const& cases = tasks[t];
+        if (cases.size() == 1)
+        {
+            Scenario const scenario = sweep.scenario(cases[0]);
+            results[cases[0]] = scenario.precision == Scenario::FLOAT
+                ? measure<float>(scenario)
+                : measure<double>(scenario);
+            continue;
+        }
+        std::vector<Scenario> scenarios;
+        for (size_t i = 0; i < cases.size(); ++i)
+            scenarios.push_back(sweep.scenario(cases[i]));
+        std::vector<Sweep::Result> const batch
+            = scenarios[0].precision == Scenario::FLOAT
+            ? measureEnsemble<float>(scenarios)
+            : measureEnsemble<double>(scenarios);
+        for (size_t i = 0; i < cases.size(); ++i) results[cases[i]] = batch[i];
+    }
+}
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                                   Sweep                                    **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+Sweep::Sweep()
+:   m_mode(GRID)
+{/* Do nothing. */}
+
+bool
+Sweep::isSweep(QString const& path)
+{
+    QSettings settings(path, QSettings::IniFormat);
+    return settings.childGroups().contains("sweep");
+}
+
+Sweep
+Sweep::load(QString const& path)
+{
+    QFileInfo const info(path);
+    QSettings settings(path, QSettings::IniFormat);
+    if (!info.isFile() || !info.isReadable()
+        || settings.status() != QSettings::NoError)
+        throw std::runtime_error("Sweep::load(): Unable to read "
+            + path.toStdString() + ".");
+
+    Sweep sweep;
+    QStringList const keys = settings.allKeys();
+    for (int i = 0; i < keys.size(); ++i)
+    {
+        QVariant const value = settings.value(keys[i]);
+        QString const text = value.userType() == QMetaType::QStringList
+            ? value.toStringList().join(",") : value.toString();
+        if (keys[i].section('/', 0, 0) != "sweep")
+            sweep.m_base.set(keys[i], text);
+        else if (keys[i] == "sweep/mode")
+        {
+            if      (text == "grid") sweep.m_mode = GRID;
+            else if (text == "list") sweep.m_mode = LIST;
+            else throw std::invalid_argument("Sweep::load(): Invalid mode "
+                + text.toStdString() + ".");
+        }
+        else sweep.addParameter(keys[i].section('/', -1), text.split(','));
+    }
+
+    if (sweep.m_names.empty())
+        throw std::invalid_argument("Sweep::load(): No parameter to sweep.");
+    for (size_t j = 0; j < sweep.m_values.size(); ++j)
+    {
+        if (sweep.m_mode == LIST
+            && sweep.m_values[j].size() != sweep.m_values[0].size())
+            throw std::invalid_argument("Sweep::load(): Lists of different \
+lengths in list mode.");
+        // Lets Scenario::set() complain about bad values before the run.
+        for (int k = 0; k < sweep.m_values[j].size(); ++k)
+            Scenario(sweep.m_base).set(sweep.m_names[j], sweep.m_values[j][k]);
+    }
+    return sweep;
+}
+
+size_t
+Sweep::caseCnt() const
+{
+    if (m_mode == LIST) return m_values[0].size();
+    size_t cnt = 1;
+    for (size_t j = 0; j < m_values.size(); ++j) cnt *= m_values[j].size();
+    return cnt;
+}
+
+Scenario
+Sweep::scenario(size_t i) const
+{
+    Scenario scenario = m_base;
+    QStringList const v = values(i);
+    for (int j = 0; j < m_names.size(); ++j) scenario.set(m_names[j], v[j]);
+    return scenario;
+}
+
+// Estimated cost of case i, in evaluations of the right-hand side per node:
+// the number of steps, times the cost of a step, times the nodes. The cost
+// of a step was measured against a lone evaluation, for 20 to 400 segments,
+// and includes the arithmetic of the integrator besides its evaluations.
+double
+Sweep::cost(size_t i) const
+{
+    static double const STEP_COST[] = {
+        1.5,    // EULER
+        7,      // RK4
+        16,     // DORMAND_PRINCE, with its largest step
+        3,      // VERLET
+        7,      // FOREST_RUTH
+        40,     // ROSENBROCK, with the Jacobian and the solves
+        6       // MODAL, besides the transforms below
+    };
+    // Evaluations of the right-hand side per step.
+    static double const EVAL_CNT[] = {
+        1,  // EULER
+        4,  // RK4
+        6,  // DORMAND_PRINCE
+        2,  // VERLET
+        4,  // FOREST_RUTH
+        3,  // ROSENBROCK
+        2   // MODAL
+    };
+    Scenario const s = scenario(i);
+    double const steps = s.duration / s.step;
+    double const nodeCnt = static_cast<double>(s.segmentCnt + 1);
+    // A reduced model integrates its modes in place of the nodes.
+    double const stateCnt = s.reduced()
+        ? static_cast<double>(s.modeCnt + 1) : nodeCnt;
+    double cost = steps * STEP_COST[s.integrator] * stateCnt;
+    // Passes over all the modes, O(n) per node: the way back to the nodes,
+    // and with drag the projection of the remainder.
+    if (s.integrator == Scenario::MODAL)
+        cost += steps * (s.density != 0 ? 2 : 1) * stateCnt * stateCnt;
+    // The reconstruction every step and the drag at the nodes, O(k) per node.
+    if (s.reduced())
+    {
+        double const passes
+            = 1 + (s.density != 0 ? EVAL_CNT[s.integrator] : 0);
+        cost += steps * passes * nodeCnt * stateCnt;
+    }
+    return cost;
+}
+
+// Estimated cost of a task, in the units of cost(). A batch costs its
+// lanes, each of which takes ENSEMBLE_STEP_COST per step and node in place
+// of the step cost of RK4. It was measured as cost() was, with the
+// vectorizer enabled as in PendulumHeadless.pro.
+double
+Sweep::taskCost(std::vector<size_t> const& task) const
+{
+    static double const ENSEMBLE_STEP_COST = 3;
+    if (task.size() == 1) return cost(task[0]);
+    Scenario const s = scenario(task[0]);
+    double const steps = s.duration / s.step;
+    double const nodeCnt = static_cast<double>(s.segmentCnt + 1);
+    return steps * ENSEMBLE_STEP_COST * nodeCnt * task.size();
+}
+
+// The cases grouped into tasks for workerCnt workers. RK4 runs of the full
+// model that share the precision, the segment count, the step and the
+// duration are batched LANE_CNT at a time, to be integrated as the lanes of
+// a PendulumEnsemble in a fraction of the time they take one by one. They
+// are only batched with at least LANE_CNT cases per worker, though, so that
+// no worker is left idle while a few others integrate all the batches. The
+// other cases, and those left over from the batches, are tasks of their own.
+std::vector<std::vector<size_t> >
+Sweep::tasks(size_t workerCnt) const
+{
+    size_t const laneCnt = PendulumEnsemble<double>::LANE_CNT;
+    size_t const cnt = caseCnt();
+    std::vector<std::vector<size_t> > tasks;
+    // The batches being filled, by the parameters their cases share.
+    std::map<std::vector<double>, std::vector<size_t> > batches;
+    for (size_t i = 0; i < cnt; ++i)
+    {
+        Scenario const s = scenario(i);
+        if (cnt < laneCnt * workerCnt || s.integrator != Scenario::RK4
+            || s.reduced())
+        {
+            tasks.push_back(std::vector<size_t>(1, i));
+            continue;
+        }
+        std::vector<double> key(4);
+        key[0] = s.precision;
+        key[1] = static_cast<double>(s.segmentCnt);
+        key[2] = s.step;
+        key[3] = s.duration;
+        std::vector<size_t>& batch = batches[key];
+        batch.push_back(i);
+        if (batch.size() < laneCnt) continue;
+        tasks.push_back(batch);
+        batch.clear();
+    }
+    std::map<std::vector<double>, std::vector<size_t> >::const_iterator it;
+    for (it = batches.begin(); it != batches.end(); ++it)
+    for (size_t j = 0; j < it->second.size(); ++j)
+        tasks.push_back(std::vector<size_t>(1, it->second[j]));
+    return tasks;
+}
+
+std::vector<Sweep::Result>
+Sweep::run(int threadCnt) const
+{
+    size_t const cnt = caseCnt();
+    size_t const workerCnt = std::max<size_t>(1,
+        std::min<size_t>(std::max(threadCnt, 1), cnt));
+    std::vector<std::vector<size_t> > const tasks = this->tasks(workerCnt);
+
+    // Dealt costliest first, each deque is in decreasing order of cost.
+    std::vector<std::pair<double, size_t> > order(tasks.size());
+    for (size_t t = 0; t < tasks.size(); ++t)
+        order[t] = std::make_pair(-taskCost(tasks[t]), t);
+    std::sort(order.begin(), order.end());
+    std::vector<SweepDeque*> deques(workerCnt);
+    for (size_t w = 0; w < workerCnt; ++w) deques[w] = new SweepDeque;
+    for (size_t t = 0; t < tasks.size(); ++t)
+        deques[t % workerCnt]->tasks.push_back(order[t].second);
+
+    std::vector<Result> results(cnt);
+    std::vector<SweepWorker*> workers(workerCnt);
+    for (size_t w = 0; w < workerCnt; ++w)
+    {
+        workers[w] = new SweepWorker(*this, tasks, deques, w, results);
+        workers[w]->start();
+    }
+    for (size_t w = 0; w < workerCnt; ++w) workers[w]->wait();
+    // Only now, as the others may have stolen from any deque till the end.
+    for (size_t w = 0; w < workerCnt; ++w)
+    {
+        delete workers[w];
+        delete deques[w];
+    }
+    return results;
+}
+
+// The swept parameters of every case followed by its metrics, as CSV.
+void
+Sweep::write(std::ostream& out, std::vector<Result> const& results) const
+{
+    out << m_names.join(",").toStdString()
+        << ",peakDeflection,steadyAmplitude,energy,seconds\n"
+        << std::setprecision(10);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        Result const& r = results[i];
+        out << values(i).join(",").toStdString() << "," << r.peakDeflection
+            << "," << r.steadyAmplitude << "," << r.energy << "," << r.seconds
+            << "\n";
+    }
+    out.flush();
+}
+
+// Lists are taken as they are, ranges from:to:step are expanded, the end
+// included if the steps land on it. Resonances like resonance:2 are values,
+// not ranges.
+void
+Sweep::addParameter(QString const& name, QStringList const& items)
+{
+    QStringList values;
+    for (int i = 0; i < items.size(); ++i)
+    {
+        QString const item = items[i].trimmed();
+        if (!item.contains(':') || item.startsWith("resonance:"))
+        {
+            values.push_back(item);
+            continue;
+        }
+        QStringList const range = item.split(':');
+        bool ok = range.size() == 3;
+        double from = 0, to = 0, step = 0;
+        if (ok) from = range[0].toDouble(&ok);
+        if (ok) to = range[1].toDouble(&ok);
+        if (ok) step = range[2].toDouble(&ok);
+        if (!ok || step <= 0 || to < from)
+            throw std::invalid_argument("Sweep::addParameter(): Invalid range "
+                + item.toStdString() + " of " + name.toStdString() + ".");
+        size_t const cnt = static_cast<size_t>((to - from) / step + 1e-9) + 1;
+        for (size_t k = 0; k < cnt; ++k)
+            values.push_back(QString::number(from + k * step, 'g', 12));
+    }
+    m_names.push_back(name);
+    m_values.push_back(values);
+}
+
+// In grid mode the last parameter varies fastest.
+QStringList
+Sweep::values(size_t i) const
+{
+    QStringList v;
+    for (size_t j = 0; j < m_values.size(); ++j) v.push_back(QString());
+    for (size_t j = m_values.size(); j-- > 0;)
+    {
+        size_t const size = m_values[j].size();
+        v[j] = m_values[j][m_mode == LIST ? i : i % size];
+        if (m_mode == GRID) i /= size;
+    }
+    return v;
+}
+
+} // namespace jg
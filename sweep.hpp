@@ -0,0 +1,86 @@
+#ifndef JG_SWEEP_HPP
+#define JG_SWEEP_HPP
+
+#include <ostream>
+#include <vector>
+
+#include <QtCore/QtCore>
+
+#include "scenario.hpp"
+
+namespace jg {
+
+// A family of scenarios differing in a few parameters, run in parallel and
+// reduced to a table of metrics. It is read from a scenario file with an
+// extra group naming the swept parameters, each given by a list of values
+// or by a range from:to:step:
+//
+//     [sweep]
+//     mode         = grid
+//     angFrequency = 1:30:0.5
+//     segmentCnt   = 1, 3, 500
+//
+// In grid mode the cases are all combinations of the values, in list mode
+// the lists are zipped and must be of equal length. Any scenario parameter
+// may be swept; the others are those of the rest of the file.
+//
+// Every case is integrated step by step on its own thread, and measured:
+// the peak tip deflection over the whole run, and over the last
+// STEADY_FRACTION of it, taken as the steady state, half the peak-to-peak
+// tip deflection and the time average of the mechanical energy.
+//
+// The cases go to a pool of one worker per core, each with a deque of its
+// own. They are dealt costliest first, so every worker starts on the
+// largest cases, and a worker out of cases steals the cheapest left at the
+// back of another's deque. This keeps the cores busy when the costs differ
+// by orders of magnitude, as with 1 against 500 segments. In large sweeps,
+// RK4 cases that differ only in the pendulum, the driver, the fluid or the
+// deflections are integrated several at a time in one PendulumEnsemble,
+// which is dealt like a single case.
+class Sweep
+{
+public:
+    enum Mode {
+        GRID,
+        LIST
+    };
+
+    struct Result
+    {
+        double  peakDeflection;
+        double  steadyAmplitude;
+        double  energy;
+        double  seconds;
+    };
+
+    static double const STEADY_FRACTION;
+
+    static bool     isSweep(QString const& path);
+    static Sweep    load(QString const& path);
+
+    size_t              caseCnt() const;
+    Scenario            scenario(size_t i) const;
+    double              cost(size_t i) const;
+    std::vector<Result> run(int threadCnt = QThread::idealThreadCount()) const;
+    void                write(std::ostream& out,
+                            std::vector<Result> const& results) const;
+
+private:
+    Scenario                    m_base;
+    Mode                        m_mode;
+    QStringList                 m_names;
+    std::vector<QStringList>    m_values;
+
+    Sweep();
+
+    void            addParameter(QString const& name,
+                        QStringList const& items);
+    QStringList     values(size_t i) const;
+    double          taskCost(std::vector<size_t> const& task) const;
+    std::vector<std::vector<size_t> >
+                    tasks(size_t workerCnt) const;
+};
+
+} // namespace jg
+
+#endif // JG_SWEEP_HPP
@@ -0,0 +1,196 @@
+#ifndef JG_SYMMETRIC_TRIDIAGONAL_HPP
+#define JG_SYMMETRIC_TRIDIAGONAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace jg {
+
+/*******************************************************************************
+********************************************************************************
+**                                                                            **
+**                          Symmetric tridiagonal                             **
+**                                                                            **
+********************************************************************************
+*******************************************************************************/
+
+// Largest number of QL sweeps spent on a single eigenvalue. Two or three are
+// typical, the shifts converge cubically.
+int const MAX_QL_ITERATIONS = 64;
+
+// Eigenvalues of the symmetric tridiagonal matrix with the diagonal d and the
+// off-diagonal e, e[k] joining rows k and k + 1, in increasing order. It is
+// the implicit QL algorithm with Wilkinson shifts: every sweep is a chain of
+// plane rotations over the unreduced block, and the eigenvalues deflate one
+// by one from the top. Without the eigenvectors the rotations need not be
+// accumulated, so it takes O(n) memory and O(n^2) time in total.
+template <typename T>
+std::vector<T>
+symmetricTridiagonalEigenvalues(std::vector<T> d, std::vector<T> e)
+{
+    size_t const n = d.size();
+    if (n > 0 && e.size() != n - 1)
+        throw std::invalid_argument("symmetricTridiagonalEigenvalues(): \
+Off-diagonal of wrong size.");
+    e.resize(n, 0);
+
+    T const eps = std::numeric_limits<T>::epsilon();
+    for (size_t l = 0; l < n; ++l)
+    {
+        for (int iter = 0;; ++iter)
+        {
+            // Looks for a negligible off-diagonal element to split at.
+            size_t m = l;
+            while (m + 1 < n
+                && std::abs(e[m]) > eps * (std::abs(d[m]) + std::abs(d[m + 1])))
+                ++m;
+            if (m == l) break;
+            if (iter == MAX_QL_ITERATIONS)
+                throw std::runtime_error("symmetricTridiagonalEigenvalues(): \
+No convergence.");
+
+            // Shift by the eigenvalue of the leading 2x2 block closer to d[l].
+            T g = (d[l + 1] - d[l]) / (2 * e[l]);
+            T r = std::sqrt(g * g + 1);
+            g = d[m] - d[l] + e[l] / (g + (g < 0 ? -r : r));
+            T s = 1, c = 1, p = 0;
+            bool underflow = false;
+            for (size_t i = m; i-- > l;)
+            {
+                T const f = s * e[i];
+                T const b = c * e[i];
+                e[i + 1] = r = std::sqrt(f * f + g * g);
+                if (r == 0)
+                {
+                    // The block splits further, start over from it.
+                    d[i + 1] -= p;
+                    e[m] = 0;
+                    underflow = true;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = d[i + 1] - p;
+                r = (d[i] - g) * s + 2 * c * b;
+                p = s * r;
+                d[i + 1] = g + p;
+                g = c * r - b;
+            }
+            if (underflow) continue;
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0;
+        }
+    }
+
+    std::sort(d.begin(), d.end());
+    return d;
+}
+
+// Inverse iterations spent on an eigenvector. The eigenvalue is accurate to
+// working precision, so the first solve nearly converges already.
+int const INVERSE_ITERATIONS = 3;
+
+// Unit eigenvector of the symmetric tridiagonal matrix with the diagonal d
+// and the off-diagonal e for its eigenvalue lambda, into x, by inverse
+// iteration: a few solves with M - lambda * I, factored once by Gaussian
+// elimination with partial pivoting, in O(n). A pivot that vanishes is
+// replaced by a tiny one, the solve then blows up right along the
+// eigenvector. For well separated eigenvalues, as those of the pendulum,
+// the eigenvectors come out orthogonal to working precision without any
+// reorthogonalization. The sign is fixed by a positive first entry.
+template <typename T>
+void
+symmetricTridiagonalEigenvector(
+    std::vector<T> const&   d,
+    std::vector<T> const&   e,
+    T                       lambda,
+    T*                      x
+)
+{
+    size_t const n = d.size();
+    if (n == 0) return;
+    if (e.size() != n - 1)
+        throw std::invalid_argument("symmetricTridiagonalEigenvector(): \
+Off-diagonal of wrong size.");
+
+    T norm = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        norm = std::max(norm, std::abs(d[i])
+            + (i > 0 ? std::abs(e[i - 1]) : 0)
+            + (i + 1 < n ? std::abs(e[i]) : 0));
+    }
+    T const tiny = std::numeric_limits<T>::epsilon() * std::max(norm, T(1));
+
+    // U has the diagonal u0 and two superdiagonals u1 and u2, L the
+    // multipliers l, row i swapped with row i + 1 first where swap[i].
+    std::vector<T> u0(n), u1(n, 0), u2(n, 0), l(n, 0);
+    std::vector<char> swap(n, 0);
+    T diag = d[0] - lambda;
+    T super = n > 1 ? e[0] : 0;
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        T const sub = e[i];
+        T const nextDiag = d[i + 1] - lambda;
+        T const nextSuper = i + 2 < n ? e[i + 1] : 0;
+        if (std::abs(diag) >= std::abs(sub))
+        {
+            if (diag == 0) diag = tiny;
+            u0[i] = diag;
+            u1[i] = super;
+            l[i] = sub / diag;
+            diag = nextDiag - l[i] * super;
+            super = nextSuper;
+        }
+        else
+        {
+            u0[i] = sub;
+            u1[i] = nextDiag;
+            u2[i] = nextSuper;
+            l[i] = diag / sub;
+            swap[i] = 1;
+            diag = super - l[i] * nextDiag;
+            super = -l[i] * nextSuper;
+        }
+    }
+    u0[n - 1] = diag == 0 ? tiny : diag;
+
+    // The first solve starts from L y = (1, ..., 1), the usual choice that
+    // has a component along every eigenvector.
+    std::fill(x, x + n, T(1));
+    for (int iter = 0; iter < INVERSE_ITERATIONS; ++iter)
+    {
+        if (iter > 0)
+        {
+            for (size_t i = 0; i + 1 < n; ++i)
+            {
+                if (swap[i]) std::swap(x[i], x[i + 1]);
+                x[i + 1] -= l[i] * x[i];
+            }
+        }
+        for (size_t i = n; i-- > 0;)
+        {
+            T r = x[i];
+            if (i + 1 < n) r -= u1[i] * x[i + 1];
+            if (i + 2 < n) r -= u2[i] * x[i + 2];
+            x[i] = r / u0[i];
+        }
+
+        T scale = 0;
+        for (size_t i = 0; i < n; ++i) scale = std::max(scale, std::abs(x[i]));
+        for (size_t i = 0; i < n; ++i) x[i] /= scale;
+    }
+
+    T sq = 0;
+    for (size_t i = 0; i < n; ++i) sq += x[i] * x[i];
+    T const s = (x[0] < 0 ? -1 : 1) / std::sqrt(sq);
+    for (size_t i = 0; i < n; ++i) x[i] *= s;
+}
+
+} // namespace jg
+
+#endif // JG_SYMMETRIC_TRIDIAGONAL_HPP
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Checks that the Euler and RK4 integrators step
+# without allocating, see README.md.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = AllocTest
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+
+SOURCES += \
+    alloc_test.cpp
+
+HEADERS  += \
+    ../spawner.hpp \
+    ../queue.hpp \
+    ../pendulum.hpp \
+    ../ode.hpp \
+    ../eventcount.hpp \
+    ../buffer.hpp \
+    ../trajectory.hpp \
+    ../block_tridiagonal.hpp \
+    ../symmetric_tridiagonal.hpp
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Checks the eigenvalues behind the resonance
+# frequencies, see README.md.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = EigenTest
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+
+SOURCES += \
+    eigen_test.cpp \
+    ../pendulum.cpp
+
+HEADERS  += \
+    ../spawner.hpp \
+    ../queue.hpp \
+    ../pendulum.hpp \
+    ../ode.hpp \
+    ../eventcount.hpp \
+    ../buffer.hpp \
+    ../trajectory.hpp \
+    ../block_tridiagonal.hpp \
+    ../symmetric_tridiagonal.hpp
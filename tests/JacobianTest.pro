@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Checks the analytic pendulum Jacobian against
+# finite differences and times both, see README.md.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = JacobianTest
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+
+SOURCES += \
+    jacobian_test.cpp
+
+HEADERS  += \
+    ../spawner.hpp \
+    ../queue.hpp \
+    ../pendulum.hpp \
+    ../ode.hpp \
+    ../eventcount.hpp \
+    ../buffer.hpp \
+    ../trajectory.hpp \
+    ../block_tridiagonal.hpp \
+    ../symmetric_tridiagonal.hpp
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Checks that the modal integrator converges at
+# second order to RK4, see README.md.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = ModalTest
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+
+SOURCES += \
+    modal_test.cpp
+
+HEADERS  += \
+    ../spawner.hpp \
+    ../queue.hpp \
+    ../pendulum.hpp \
+    ../ode.hpp \
+    ../eventcount.hpp \
+    ../buffer.hpp \
+    ../trajectory.hpp \
+    ../block_tridiagonal.hpp \
+    ../symmetric_tridiagonal.hpp
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Checks the error estimate of the reduced
+# pendulum equation, see README.md.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = ReducedTest
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+
+SOURCES += \
+    reduced_test.cpp \
+    ../pendulum.cpp
+
+HEADERS  += \
+    ../spawner.hpp \
+    ../queue.hpp \
+    ../pendulum.hpp \
+    ../ode.hpp \
+    ../eventcount.hpp \
+    ../buffer.hpp \
+    ../trajectory.hpp \
+    ../block_tridiagonal.hpp \
+    ../symmetric_tridiagonal.hpp
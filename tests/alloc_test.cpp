@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "pendulum.hpp"
+
+// Every allocation in the process goes through these, so the count tells
+// whether a stretch of code touched the heap.
+static size_t allocationCnt = 0;
+
+static void* allocate(size_t size)
+{
+    ++allocationCnt;
+    void* const p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace jg {
+
+size_t const STEP_CNT = 10000;
+
+// Advances a deflected pendulum of segmentCnt segments a few steps, so that
+// the integrator can size its workspace, and then counts the allocations of
+// STEP_CNT more. Returns whether there were none.
+template <typename T>
+bool
+checkAdvance(std::string const& name, Integrator<T>* integrator,
+    ODEFun<T> const& f, size_t segmentCnt)
+{
+    typename ODE<T>::Point p(0, typename ODE<T>::Y(2 * (segmentCnt + 1), 0));
+    for (size_t i = 1; i <= segmentCnt; ++i) p.y[i] = static_cast<T>(0.1) * i;
+    for (size_t k = 0; k < 3; ++k) integrator->advance(p, f);
+
+    size_t const before = allocationCnt;
+    for (size_t k = 0; k < STEP_CNT; ++k) integrator->advance(p, f);
+    size_t const allocations = allocationCnt - before;
+    delete integrator;
+
+    std::cout << name << ", " << segmentCnt << " segments: " << allocations
+        << " allocations in " << STEP_CNT << " steps" << std::endl;
+    return allocations == 0;
+}
+
+template <typename T>
+bool
+checkEquation(size_t segmentCnt)
+{
+    PendulumODEFun<T> const pendulum(2, 1, 0.25, 20, 0.1, 1, 10);
+    ODEFun<T>* const f = newPendulumODEFun(pendulum, segmentCnt);
+    typename ODE<T>::X const step = static_cast<T>(1e-4);
+    bool ok = true;
+    ok &= checkAdvance("Euler", new EulerIntegrator<T>(step), *f, segmentCnt);
+    ok &= checkAdvance("RK4", new RK4Integrator<T>(step), *f, segmentCnt);
+    if (segmentCnt <= MAX_FIXED_SEGMENT_CNT)
+        ok &= checkAdvance("Fixed RK4", newRK4Integrator<T>(segmentCnt, step),
+            *f, segmentCnt);
+    delete f;
+    return ok;
+}
+
+} // namespace jg
+
+// Checks that the Euler and RK4 integrators do not allocate once they have
+// stepped the system, with the plain and the fixed size pendulum equations.
+int main()
+{
+    bool ok = true;
+    size_t const segmentCnts[] = { 1, 4, 16, 40 };
+    for (size_t i = 0; i < sizeof(segmentCnts) / sizeof(size_t); ++i)
+    {
+        ok &= jg::checkEquation<float>(segmentCnts[i]);
+        ok &= jg::checkEquation<double>(segmentCnts[i]);
+    }
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "pendulum.hpp"
+#include "symmetric_tridiagonal.hpp"
+
+namespace jg {
+
+// Eigenvalues of the pendulums of 1 to 9 segments to 12 digits, the table the
+// interface carried before they were computed. They are the roots of the
+// Laguerre polynomials.
+double const TABLE[9][9] = {
+    { 1.000000000000 },
+    { 0.585786437627, 3.414213562373 },
+    { 0.415774556783, 2.294280360279, 6.289945082937 },
+    { 0.322547689619, 1.745761101158, 4.536620296921, 9.395070912301 },
+    { 0.263560319718, 1.413403059107, 3.596425771041, 7.085810005859,
+        12.640800844276 },
+    { 0.222846604179, 1.188932101673, 2.992736326059, 5.775143569105,
+        9.837467418383, 15.982873980602 },
+    { 0.193043676560, 1.026664895339, 2.567876744951, 4.900353084526,
+        8.182153444563, 12.734180291798, 19.395727862263 },
+    { 0.170279632305, 0.903701776799, 2.251086629866, 4.266700170288,
+        7.045905402393, 10.758516010181, 15.740678641278, 22.863131736889 },
+    { 0.152322227732, 0.807220022742, 2.005135155619, 3.783473973331,
+        6.204956777877, 9.372985251688, 13.466236911092, 18.833597788992,
+        26.374071890927 }
+};
+
+// The table is rounded to 12 decimals.
+double const TABLE_TOLERANCE = 1e-11;
+
+// The eigenvalues of a pendulum of n segments sum to the trace of its
+// matrix, n^2, to about this much relative to it.
+double const TRACE_TOLERANCE = 1e-12;
+
+// The eigenvectors are orthonormal and solve the eigenproblem to about this
+// much, relative to the largest eigenvalue for the residual.
+double const VECTOR_TOLERANCE = 1e-10;
+
+// Compares resonanceEigenvalues() with the table. Returns whether every
+// eigenvalue agrees within TABLE_TOLERANCE.
+bool
+checkTable()
+{
+    double error = 0;
+    for (size_t n = 1; n <= 9; ++n)
+    {
+        std::vector<double> const& lambdas = resonanceEigenvalues(n);
+        if (lambdas.size() != n)
+        {
+            std::cout << n << " segments: " << lambdas.size()
+                << " eigenvalues" << std::endl;
+            return false;
+        }
+        for (size_t j = 0; j < n; ++j)
+            error = std::max(error, std::abs(lambdas[j] - TABLE[n - 1][j]));
+    }
+    std::cout << "1 to 9 segments: largest difference from the table "
+        << error << std::endl;
+    return error <= TABLE_TOLERANCE;
+}
+
+// Checks that the eigenvalues of a pendulum of n segments increase and sum
+// to the trace.
+bool
+checkTrace(size_t n)
+{
+    std::vector<double> const& lambdas = resonanceEigenvalues(n);
+    double sum = 0;
+    bool increasing = true;
+    for (size_t j = 0; j < lambdas.size(); ++j)
+    {
+        sum += lambdas[j];
+        if (j > 0 && !(lambdas[j - 1] < lambdas[j])) increasing = false;
+    }
+    double const trace = static_cast<double>(n) * n;
+    double const error = std::abs(sum - trace) / trace;
+    std::cout << n << " segments: relative trace error " << error
+        << (increasing ? "" : ", not increasing") << std::endl;
+    return increasing && error <= TRACE_TOLERANCE;
+}
+
+// Computes all eigenvectors of the pendulum of n segments with
+// symmetricTridiagonalEigenvector(), for the matrix documented with
+// resonanceEigenvalues(). Returns whether they are orthonormal and their
+// residuals small, both within VECTOR_TOLERANCE.
+bool
+checkVectors(size_t n)
+{
+    std::vector<double> d(n), e(n - 1);
+    for (size_t k = 1; k <= n; ++k)
+    {
+        d[k - 1] = 2.0 * (n - k) + 1;
+        if (k < n) e[k - 1] = -static_cast<double>(n - k);
+    }
+    std::vector<double> const& lambdas = resonanceEigenvalues(n);
+    std::vector<double> u(n * n);
+    for (size_t j = 0; j < n; ++j)
+        symmetricTridiagonalEigenvector(d, e, lambdas[j], &u[j * n]);
+
+    double residual = 0;
+    for (size_t j = 0; j < n; ++j)
+    {
+        double const* v = &u[j * n];
+        for (size_t i = 0; i < n; ++i)
+        {
+            double Mv = d[i] * v[i];
+            if (i > 0) Mv += e[i - 1] * v[i - 1];
+            if (i + 1 < n) Mv += e[i] * v[i + 1];
+            residual = std::max(residual, std::abs(Mv - lambdas[j] * v[i]));
+        }
+    }
+    residual /= lambdas[n - 1];
+
+    double orthogonality = 0;
+    for (size_t j = 0; j < n; ++j)
+    for (size_t k = 0; k <= j; ++k)
+    {
+        double dot = 0;
+        for (size_t i = 0; i < n; ++i) dot += u[j * n + i] * u[k * n + i];
+        orthogonality = std::max(orthogonality,
+            std::abs(dot - (j == k ? 1 : 0)));
+    }
+
+    std::cout << n << " segments: eigenvectors off orthonormal by "
+        << orthogonality << ", relative residual " << residual << std::endl;
+    return orthogonality <= VECTOR_TOLERANCE && residual <= VECTOR_TOLERANCE;
+}
+
+} // namespace jg
+
+// Checks the eigenvalues of the pendulum matrix, behind the resonance
+// frequencies, against the old table and, for long chains, the trace, and
+// that the eigenvectors computed for them are orthonormal.
+int main()
+{
+    using namespace jg;
+
+    bool ok = checkTable();
+    size_t const segmentCnts[] = { 10, 100, 1000 };
+    for (size_t i = 0; i < sizeof(segmentCnts) / sizeof(size_t); ++i)
+    {
+        ok &= checkTrace(segmentCnts[i]);
+        ok &= checkVectors(segmentCnts[i]);
+    }
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
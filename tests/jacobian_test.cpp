@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <QtCore/QtCore>
+
+#include "pendulum.hpp"
+
+namespace jg {
+
+// Entries of the analytic and the finite difference Jacobian may differ by
+// this much relative to the larger of one and the entry. Forward differences
+// are good to about the square root of the machine epsilon.
+double const TOLERANCE = 1e-5;
+
+size_t const STATE_CNT = 20;
+size_t const TIMING_CNT = 2000;
+
+// A random state of a pendulum of segmentCnt segments, deflections and
+// velocities of either sign, so that the drag is differentiated on both of
+// its branches.
+ODE<double>::Y
+randomState(std::mt19937& random, size_t segmentCnt)
+{
+    std::uniform_real_distribution<double> deflection(-0.5, 0.5);
+    std::uniform_real_distribution<double> velocity(-3, 3);
+    size_t const m = segmentCnt + 1;
+    ODE<double>::Y y(2 * m, 0);
+    for (size_t i = 1; i < m; ++i)
+    {
+        y[i] = deflection(random);
+        y[m + i] = velocity(random);
+    }
+    return y;
+}
+
+// Compares the analytic Jacobian of f with finiteDifferenceJacobian() at
+// random states and times, and times both. Returns whether every entry, in
+// the band and outside it, agrees within TOLERANCE.
+bool
+checkJacobian(std::string const& name, ODEFun<double> const& f,
+    size_t segmentCnt)
+{
+    std::mt19937 random(segmentCnt);
+    std::uniform_real_distribution<double> time(0, 10);
+    size_t const n = 2 * (segmentCnt + 1);
+    ODE<double>::Y dy(n), z, dz;
+    BlockTridiagonal<double> analytic, difference;
+
+    double error = 0;
+    for (size_t k = 0; k < STATE_CNT; ++k)
+    {
+        ODE<double>::Y const y = randomState(random, segmentCnt);
+        double const x = time(random);
+        f.eval(x, &y[0], &dy[0], n);
+        if (!f.jacobian(x, &y[0], n, analytic))
+        {
+            std::cout << name << ": no analytic Jacobian" << std::endl;
+            return false;
+        }
+        finiteDifferenceJacobian(f, x, y, dy, difference, z, dz);
+
+        BlockTridiagonal<double> const& a = analytic;
+        BlockTridiagonal<double> const& b = difference;
+        for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+        {
+            double const scale = std::max(1.0, std::abs(a(i, j)));
+            error = std::max(error, std::abs(a(i, j) - b(i, j)) / scale);
+        }
+    }
+
+    ODE<double>::Y const y = randomState(random, segmentCnt);
+    f.eval(1, &y[0], &dy[0], n);
+    QElapsedTimer timer;
+    timer.start();
+    for (size_t k = 0; k < TIMING_CNT; ++k)
+        f.jacobian(1, &y[0], n, analytic);
+    double const analyticTime = timer.nsecsElapsed() / 1e3 / TIMING_CNT;
+    timer.start();
+    for (size_t k = 0; k < TIMING_CNT; ++k)
+        finiteDifferenceJacobian(f, 1.0, y, dy, difference, z, dz);
+    double const differenceTime = timer.nsecsElapsed() / 1e3 / TIMING_CNT;
+
+    std::cout << name << ", " << segmentCnt << " segments: largest relative "
+        "difference " << error << ", analytic " << analyticTime << " us, "
+        "finite differences " << differenceTime << " us" << std::endl;
+    return error <= TOLERANCE;
+}
+
+} // namespace jg
+
+// Checks the analytic Jacobian of the pendulum equation, with the plain and
+// the fixed size kernels, with and without drag, against finite differences.
+int main()
+{
+    using namespace jg;
+
+    bool ok = true;
+    size_t const segmentCnts[] = { 1, 2, 7, 16, 100 };
+    for (size_t i = 0; i < sizeof(segmentCnts) / sizeof(size_t); ++i)
+    {
+        size_t const segmentCnt = segmentCnts[i];
+        PendulumODEFun<double> const still(1.5, 0.7, 0.3, 13, 0.1, 0, 0);
+        PendulumODEFun<double> const drag(1.5, 0.7, 0.3, 13, 0.1, 2, 50);
+        ok &= checkJacobian("No drag", still, segmentCnt);
+        ok &= checkJacobian("Drag", drag, segmentCnt);
+        // Fixed size kernels only exist up to MAX_FIXED_SEGMENT_CNT.
+        if (segmentCnt > MAX_FIXED_SEGMENT_CNT) continue;
+        ODEFun<double>* const fixed = newPendulumODEFun(drag, segmentCnt);
+        ok &= checkJacobian("Drag, fixed size", *fixed, segmentCnt);
+        delete fixed;
+    }
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "pendulum.hpp"
+
+namespace jg {
+
+double const DURATION = 1;
+double const REFERENCE_STEP = 1e-5;
+double const COARSEST_STEP = 2e-2;
+size_t const HALVING_CNT = 4;
+
+// Each halving of the step must cut the error by a factor of about four;
+// the coarsest steps on the longer chain are not quite asymptotic yet.
+double const MIN_ORDER = 1.8;
+double const MAX_ORDER = 2.3;
+
+// Integrates a deflected pendulum of segmentCnt segments from rest over
+// DURATION and returns the state.
+ODE<double>::Y
+solve(Integrator<double>* integrator, ODEFun<double> const& f,
+    size_t segmentCnt)
+{
+    ODE<double>::Point p(0, ODE<double>::Y(2 * (segmentCnt + 1), 0));
+    for (size_t i = 1; i <= segmentCnt; ++i) p.y[i] = 0.05 * i;
+    size_t const stepCnt
+        = static_cast<size_t>(std::floor(DURATION / integrator->step() + 0.5));
+    for (size_t k = 0; k < stepCnt; ++k) integrator->advance(p, f);
+    delete integrator;
+    return p.y;
+}
+
+// Compares the modal integrator at COARSEST_STEP and its halvings with RK4
+// at REFERENCE_STEP. Returns whether the observed order of every halving is
+// between MIN_ORDER and MAX_ORDER.
+bool
+checkConvergence(std::string const& name, ODEFun<double> const& f,
+    size_t segmentCnt)
+{
+    ODE<double>::Y const reference
+        = solve(new RK4Integrator<double>(REFERENCE_STEP), f, segmentCnt);
+
+    bool ok = true;
+    double h = COARSEST_STEP;
+    double previous = 0;
+    for (size_t k = 0; k <= HALVING_CNT; ++k, h /= 2)
+    {
+        ODE<double>::Y const y
+            = solve(new ModalIntegrator<double>(h), f, segmentCnt);
+        double error = 0;
+        for (size_t i = 0; i < y.size(); ++i)
+            error = std::max(error, std::abs(y[i] - reference[i]));
+
+        std::cout << name << ", " << segmentCnt << " segments, step " << h
+            << ": error " << error;
+        if (k > 0)
+        {
+            double const order = std::log(previous / error) / std::log(2.0);
+            std::cout << ", order " << order;
+            ok &= order >= MIN_ORDER && order <= MAX_ORDER;
+        }
+        std::cout << std::endl;
+        previous = error;
+    }
+    return ok;
+}
+
+} // namespace jg
+
+// Checks that the modal integrator converges at second order against RK4 at
+// a tiny step, with and without drag, on a short and on a longer chain.
+int main()
+{
+    using namespace jg;
+
+    bool ok = true;
+    size_t const segmentCnts[] = { 8, 40 };
+    for (size_t i = 0; i < sizeof(segmentCnts) / sizeof(size_t); ++i)
+    {
+        size_t const segmentCnt = segmentCnts[i];
+        PendulumODEFun<double> const still(0.5, 1, 0.1, 5, 0.1, 0.2, 0);
+        PendulumODEFun<double> const drag(0.5, 1, 0.1, 5, 0.1, 0.2, 50);
+        ok &= checkConvergence("No drag", still, segmentCnt);
+        ok &= checkConvergence("Drag", drag, segmentCnt);
+    }
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,110 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "pendulum.hpp"
+
+namespace jg {
+
+size_t const SEGMENT_CNT = 40;
+double const LENGTH = 0.05;
+double const STEP = 1e-4;
+double const SAMPLE_INTERVAL = 0.05;
+// The free vibrations set off by the abrupt start, which the estimate does
+// not see, have died out by then with the viscosity of the checks.
+double const SETTLE_TIME = 2;
+double const DURATION = 5;
+
+// The estimate must be within this factor of the actual error, in the root
+// mean square over the samples after SETTLE_TIME.
+double const MIN_RATIO = 0.75;
+double const MAX_RATIO = 1.25;
+
+// With all the modes, the reduced solution is the full one up to rounding.
+double const COMPLETE_TOLERANCE = 1e-10;
+
+// Integrates the full and the reduced equation of a pendulum at rest side by
+// side with RK4, and compares the distance of the reconstructed deflections
+// from the full ones with errorEstimate(). Returns whether the estimate is
+// good to between MIN_RATIO and MAX_RATIO, or, with all the modes, whether
+// both are nothing.
+bool
+checkEstimate(std::string const& name, PendulumODEFun<double> const& f,
+    size_t modeCnt)
+{
+    size_t const n = SEGMENT_CNT;
+    PendulumModes const modes(n, modeCnt);
+    ReducedPendulumODEFun<double> const reduced(f, modes);
+    ODE<double>::Point full(0, ODE<double>::Y(2 * (n + 1), 0));
+    ODE<double>::Point z(0, ODE<double>::Y(2 * (modeCnt + 1), 0));
+    RK4Integrator<double> fullIntegrator(STEP);
+    RK4Integrator<double> reducedIntegrator(STEP);
+    ODE<double>::Y y(2 * (n + 1));
+
+    double actualSq = 0;
+    double estimateSq = 0;
+    double largest = 0;
+    size_t settledCnt = 0;
+    size_t const sampleCnt
+        = static_cast<size_t>(std::floor(DURATION / SAMPLE_INTERVAL + 0.5));
+    for (size_t s = 1; s <= sampleCnt; ++s)
+    {
+        double const x = s * SAMPLE_INTERVAL;
+        while (full.x < x - STEP / 2)
+        {
+            fullIntegrator.advance(full, f);
+            reducedIntegrator.advance(z, reduced);
+        }
+        modes.reconstruct(&z.y[0], &y[0]);
+        double sq = 0;
+        for (size_t i = 1; i <= n; ++i) sq += math::sq(y[i] - full.y[i]);
+        double const actual = std::sqrt(sq);
+        double const estimate = reduced.errorEstimate(z.x, &z.y[0]);
+        largest = std::max(largest, std::max(actual, estimate));
+        if (x <= SETTLE_TIME) continue;
+        ++settledCnt;
+        actualSq += actual * actual;
+        estimateSq += estimate * estimate;
+    }
+
+    if (modes.complete())
+    {
+        std::cout << name << ", all " << modeCnt << " modes: largest error "
+            "or estimate " << largest << std::endl;
+        return largest <= COMPLETE_TOLERANCE;
+    }
+    double const ratio = std::sqrt(estimateSq / actualSq);
+    std::cout << name << ", " << modeCnt << " modes: root mean square error "
+        << std::sqrt(actualSq / settledCnt)
+        << ", estimated by a factor of " << ratio << std::endl;
+    return ratio >= MIN_RATIO && ratio <= MAX_RATIO;
+}
+
+} // namespace jg
+
+// Checks the error estimate of the reduced pendulum equation against the
+// full equation, for drivers slower than the first mode left out, with and
+// without drag.
+int main()
+{
+    using namespace jg;
+
+    bool ok = true;
+    size_t const modeCnts[] = { 5, 10, SEGMENT_CNT };
+    double const angFrequencies[] = { 3, 8 };
+    for (size_t i = 0; i < sizeof(modeCnts) / sizeof(size_t); ++i)
+    for (size_t j = 0; j < sizeof(angFrequencies) / sizeof(double); ++j)
+    {
+        double const w = angFrequencies[j];
+        std::ostringstream driver;
+        driver << ", driven at " << w << " rad/s";
+        PendulumODEFun<double> const still(LENGTH, 1, 0.1, w, 0.02, 100, 0);
+        PendulumODEFun<double> const drag(LENGTH, 1, 0.1, w, 0.02, 100, 1000);
+        ok &= checkEstimate("No drag" + driver.str(), still, modeCnts[i]);
+        ok &= checkEstimate("Drag" + driver.str(), drag, modeCnts[i]);
+    }
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
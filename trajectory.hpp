@@ -0,0 +1,551 @@
+#ifndef JG_TRAJECTORY_HPP
+#define JG_TRAJECTORY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace jg {
+
+// Ring of trajectory points (x, y, dy) of a fixed dimension, stored in a
+// single 64-byte aligned slab: the x values first, then the state rows and
+// then the derivative rows, each section starting on a fresh cache line and
+// each row taking exactly dimension values. Points are accessed through
+// lightweight row views pointing into the slab. The producer fills the row
+// returned by beginPush() and publishes it with endPush().
+//
+// Besides by its capacity, the ring may be bounded by a horizon in x: once
+// the stored points span at least the horizon, it counts as full.
+//
+// The ring is shared by one producer thread and one primary consumer thread
+// in the same way as Queue. The capacity and the dimension may be changed
+// only while neither side is active; changing the dimension discards the
+// points.
+//
+// Up to MAX_READERS secondary readers may attach at any time, each with its
+// own cursor, and copy points out with read(). A reader starts with the
+// points pushed after it attached. The producer waits for the slowest of
+// the primary consumer and the lossless readers, while it never waits for
+// lossy readers: a lossy reader that falls a whole capacity behind skips
+// the overwritten points, which it detects after copying a row, as in a
+// sequence lock. Readers that are not attached cost the producer nothing.
+template <typename T>
+class Trajectory
+{
+public:
+    static size_t const DEFAULT_CAPACITY = 128;
+    static size_t const MAX_READERS = 8;
+
+    struct Row
+    {
+        T*  x;
+        T*  y;
+        T*  dy;
+    };
+
+    struct ConstRow
+    {
+        T const*    x;
+        T const*    y;
+        T const*    dy;
+    };
+
+    typedef Row         Reference;
+    typedef ConstRow    ConstReference;
+
+    explicit Trajectory(size_t capacity = DEFAULT_CAPACITY,
+        size_t dimension = 1);
+    ~Trajectory();
+
+    ConstRow    front() const;
+    ConstRow    back() const;
+    ConstRow    at(size_t i) const;
+    Row         beginPush();
+    void        endPush();
+    void        pop();
+    size_t      dropBefore(T x);
+    void        clear();
+    size_t      size() const;
+    size_t      capacity() const;
+    void        setCapacity(size_t capacity);
+    size_t      dimension() const;
+    void        setDimension(size_t dimension);
+    void        reset(size_t capacity, size_t dimension);
+    T           horizon() const;
+    void        setHorizon(T horizon);
+    bool        empty() const;
+    bool        full() const;
+
+    int         attachReader(bool lossy = false);
+    void        detachReader(int reader);
+    bool        read(int reader, T& x, T* y, T* dy);
+    size_t      dropped(int reader) const;
+    bool        hasLosslessReaders() const;
+
+private:
+    static size_t const CACHE_LINE_SIZE = 64;
+
+    enum ReaderMode
+    {
+        DETACHED,
+        ATTACHING,
+        LOSSLESS,
+        LOSSY
+    };
+
+    struct Cursor
+    {
+        std::atomic<size_t> head;
+        std::atomic<int>    mode;
+        std::atomic<size_t> dropped;
+        char                pad[CACHE_LINE_SIZE];
+    };
+
+    char*               m_slab;
+    T*                  m_x;
+    T*                  m_y;
+    T*                  m_dy;
+    size_t              m_capacity;
+    size_t              m_dimension;
+    T                   m_horizon;
+    char                m_slabPad[CACHE_LINE_SIZE];
+
+    std::atomic<size_t> m_head;         // Written by the consumer.
+    mutable size_t      m_tailCache;
+    char                m_headPad[CACHE_LINE_SIZE];
+
+    std::atomic<size_t> m_tail;         // Written by the producer.
+    mutable size_t      m_headCache;
+    char                m_tailPad[CACHE_LINE_SIZE];
+
+    Cursor              m_readers[MAX_READERS];
+
+    void    reallocate(size_t capacity, size_t dimension, size_t keep);
+    Row     row(size_t index) const;
+    bool    spansHorizon(size_t head, size_t tail) const;
+    size_t  slowestHead(size_t tail) const;
+
+    static size_t readerIndex(int reader);
+};
+
+template <typename T> inline
+Trajectory<T>::Trajectory(size_t capacity, size_t dimension)
+:   m_slab(NULL),
+    m_x(NULL),
+    m_y(NULL),
+    m_dy(NULL),
+    m_capacity(0),
+    m_dimension(0),
+    m_horizon(0),
+    m_head(0),
+    m_tailCache(0),
+    m_tail(0),
+    m_headCache(0)
+{
+    if (capacity <= 0 || dimension <= 0)
+        throw std::invalid_argument("Trajectory::Trajectory(): Capacity and \
+dimension must be greater than zero.");
+    for (size_t i = 0; i < MAX_READERS; ++i)
+    {
+        m_readers[i].head.store(0);
+        m_readers[i].mode.store(DETACHED);
+        m_readers[i].dropped.store(0);
+    }
+    reallocate(capacity, dimension, 0);
+}
+
+template <typename T> inline
+Trajectory<T>::~Trajectory()
+{
+    delete[] m_slab;
+}
+
+template <typename T>
+inline typename Trajectory<T>::ConstRow
+Trajectory<T>::front() const { return at(0); }
+
+template <typename T>
+inline typename Trajectory<T>::ConstRow
+Trajectory<T>::back() const
+{
+    m_tailCache = m_tail.load(std::memory_order_acquire);
+    if (m_tailCache == m_head.load(std::memory_order_relaxed))
+        throw std::range_error("Trajectory::back(): Looking up empty \
+container.");
+    Row const r = row(m_tailCache - 1);
+    ConstRow const c = { r.x, r.y, r.dy };
+    return c;
+}
+
+template <typename T>
+inline typename Trajectory<T>::ConstRow
+Trajectory<T>::at(size_t i) const
+{
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    if (m_tailCache - head <= i)
+    {
+        m_tailCache = m_tail.load(std::memory_order_acquire);
+        if (m_tailCache - head <= i)
+            throw std::range_error("Trajectory::at(): Index out of range.");
+    }
+    Row const r = row(head + i);
+    ConstRow const c = { r.x, r.y, r.dy };
+    return c;
+}
+
+template <typename T>
+inline typename Trajectory<T>::Row
+Trajectory<T>::beginPush()
+{
+    if (full())
+        throw std::range_error("Trajectory::beginPush(): Pushing to a full \
+container.");
+    // Orders the writes to the row after the publication of the point that
+    // was there before, for lossy readers checking for overwrites.
+    std::atomic_thread_fence(std::memory_order_release);
+    return row(m_tail.load(std::memory_order_relaxed));
+}
+
+template <typename T>
+inline void
+Trajectory<T>::endPush()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+}
+
+template <typename T>
+inline void
+Trajectory<T>::pop()
+{
+    if (empty())
+        throw std::range_error("Trajectory::pop(): Popping an empty \
+container.");
+    else
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+}
+
+// Drops at once all points up to the last one not after x, which becomes the
+// front, found by bisection as x grows along the ring. Returns the number of
+// points dropped. Consumer side.
+template <typename T>
+size_t
+Trajectory<T>::dropBefore(T x)
+{
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    size_t const tail = m_tail.load(std::memory_order_acquire);
+    if (tail - head < 2) return 0;
+
+    // The first point after the front that is not before x.
+    size_t lo = head + 1;
+    size_t hi = tail;
+    while (lo < hi)
+    {
+        size_t const mid = lo + (hi - lo) / 2;
+        if (*row(mid).x < x) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo - 1 != head) m_head.store(lo - 1, std::memory_order_release);
+    return lo - 1 - head;
+}
+
+// Also moves the readers to the end, from the consumer side. A reader in the
+// middle of read() then finds its cursor moved, throws its copy away and
+// starts over at the end, so it never takes a point from before clear()
+// for one after.
+template <typename T>
+inline void
+Trajectory<T>::clear()
+{
+    size_t const tail = m_tail.load(std::memory_order_acquire);
+    m_head.store(tail, std::memory_order_release);
+    for (size_t i = 0; i < MAX_READERS; ++i)
+        m_readers[i].head.store(tail, std::memory_order_release);
+}
+
+template <typename T>
+inline size_t
+Trajectory<T>::size() const
+{
+    size_t const head = m_head.load(std::memory_order_acquire);
+    return m_tail.load(std::memory_order_acquire) - head;
+}
+
+template <typename T> inline size_t
+Trajectory<T>::capacity() const { return m_capacity; }
+
+template <typename T>
+inline void
+Trajectory<T>::setCapacity(size_t capacity)
+{
+    if (capacity <= 0)
+        throw std::invalid_argument("Trajectory::setCapacity(): Capacity \
+must be greater than zero.");
+    if (capacity < size())
+        throw std::invalid_argument("Trajectory::setCapacity(): Capacity \
+must not be smaller than the size.");
+    if (capacity != m_capacity) reallocate(capacity, m_dimension, size());
+}
+
+template <typename T> inline size_t
+Trajectory<T>::dimension() const { return m_dimension; }
+
+template <typename T>
+inline void
+Trajectory<T>::setDimension(size_t dimension)
+{
+    if (dimension <= 0)
+        throw std::invalid_argument("Trajectory::setDimension(): Dimension \
+must be greater than zero.");
+    if (dimension != m_dimension) reallocate(m_capacity, dimension, 0);
+    else clear();
+}
+
+// Discards the points and reshapes the storage.
+template <typename T>
+inline void
+Trajectory<T>::reset(size_t capacity, size_t dimension)
+{
+    if (capacity <= 0 || dimension <= 0)
+        throw std::invalid_argument("Trajectory::reset(): Capacity and \
+dimension must be greater than zero.");
+    if (capacity != m_capacity || dimension != m_dimension)
+        reallocate(capacity, dimension, 0);
+    else clear();
+}
+
+template <typename T> inline T
+Trajectory<T>::horizon() const { return m_horizon; }
+
+// A horizon of zero leaves the ring bounded by its capacity only.
+template <typename T>
+inline void
+Trajectory<T>::setHorizon(T horizon)
+{
+    if (horizon < 0)
+        throw std::invalid_argument("Trajectory::setHorizon(): Horizon must \
+not be negative.");
+    m_horizon = horizon;
+}
+
+template <typename T>
+inline bool
+Trajectory<T>::empty() const
+{
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    if (head != m_tailCache) return false;
+    m_tailCache = m_tail.load(std::memory_order_acquire);
+    return head == m_tailCache;
+}
+
+template <typename T>
+inline bool
+Trajectory<T>::full() const
+{
+    size_t const tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_headCache < m_capacity && !spansHorizon(m_headCache, tail))
+        return false;
+    m_headCache = slowestHead(tail);
+    return tail - m_headCache >= m_capacity
+        || spansHorizon(m_headCache, tail);
+}
+
+// Returns the id of a new secondary reader, starting at the current end.
+template <typename T>
+int
+Trajectory<T>::attachReader(bool lossy)
+{
+    for (size_t i = 0; i < MAX_READERS; ++i)
+    {
+        Cursor& c = m_readers[i];
+        int expected = DETACHED;
+        if (c.mode.compare_exchange_strong(expected, ATTACHING))
+        {
+            c.head.store(m_tail.load(std::memory_order_acquire),
+                std::memory_order_relaxed);
+            c.dropped.store(0, std::memory_order_relaxed);
+            c.mode.store(lossy ? LOSSY : LOSSLESS, std::memory_order_release);
+            return static_cast<int>(i) + 1;
+        }
+    }
+    throw std::runtime_error("Trajectory::attachReader(): Too many readers.");
+}
+
+template <typename T>
+inline void
+Trajectory<T>::detachReader(int reader)
+{
+    m_readers[readerIndex(reader)].mode.store(DETACHED,
+        std::memory_order_release);
+}
+
+// Copies the next point of the reader out, returning false if there is
+// none yet. y and dy must hold dimension() values.
+template <typename T>
+bool
+Trajectory<T>::read(int reader, T& x, T* y, T* dy)
+{
+    Cursor& c = m_readers[readerIndex(reader)];
+    bool const lossy = c.mode.load(std::memory_order_relaxed) == LOSSY;
+    size_t cursor = c.head.load(std::memory_order_acquire);
+    size_t head = cursor;
+    for (;;)
+    {
+        size_t const tail = m_tail.load(std::memory_order_acquire);
+        if (tail == head) return false;
+        // The producer waits for a lossless reader, so a whole capacity of
+        // points ahead of it are all still there.
+        if (lossy && tail - head >= m_capacity)
+        {
+            // The point at tail - capacity may be being overwritten.
+            c.dropped.fetch_add(tail - head - (m_capacity - 1),
+                std::memory_order_relaxed);
+            head = tail - (m_capacity - 1);
+        }
+
+        // A lossy reader may copy a row the producer is overwriting, and so
+        // may any reader whose cursor clear() moves meanwhile; the checks
+        // below then throw the copy away, seqlock style.
+        Row const r = row(head);
+        x = *r.x;
+        std::copy(r.y, r.y + m_dimension, y);
+        std::copy(r.dy, r.dy + m_dimension, dy);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (lossy
+            && m_tail.load(std::memory_order_relaxed) - head >= m_capacity)
+            continue;
+        // Fails, reloading the cursor, if clear() has moved it.
+        if (c.head.compare_exchange_strong(cursor, head + 1,
+                std::memory_order_acq_rel, std::memory_order_acquire))
+            return true;
+        head = cursor;
+    }
+}
+
+// Number of points a lossy reader has skipped. May be read from any thread.
+template <typename T>
+inline size_t
+Trajectory<T>::dropped(int reader) const
+{
+    return m_readers[readerIndex(reader)].dropped.load(
+        std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool
+Trajectory<T>::hasLosslessReaders() const
+{
+    for (size_t i = 0; i < MAX_READERS; ++i)
+        if (m_readers[i].mode.load(std::memory_order_relaxed) == LOSSLESS)
+            return true;
+    return false;
+}
+
+// Moves to a new slab, keeping the keep oldest points.
+template <typename T>
+void
+Trajectory<T>::reallocate(size_t capacity, size_t dimension, size_t keep)
+{
+    size_t const perLine    = CACHE_LINE_SIZE / sizeof(T);
+    size_t const xCnt       = (capacity + perLine - 1) / perLine * perLine;
+    size_t const yCnt
+        = (capacity * dimension + perLine - 1) / perLine * perLine;
+
+    char* slab;
+    try
+    {
+        slab = new char[(xCnt + 2 * yCnt) * sizeof(T) + CACHE_LINE_SIZE];
+    }
+    catch(...)
+    {
+        throw std::runtime_error("Trajectory::reallocate(): Unable to \
+allocate storage.");
+    }
+
+    size_t const offset = reinterpret_cast<size_t>(slab) % CACHE_LINE_SIZE;
+    T* const x  = reinterpret_cast<T*>(
+        slab + (offset == 0 ? 0 : CACHE_LINE_SIZE - offset));
+    T* const y  = x + xCnt;
+    T* const dy = y + yCnt;
+
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < keep; ++i)
+    {
+        Row const r = row(head + i);
+        x[i] = *r.x;
+        std::copy(r.y, r.y + dimension, y + i * dimension);
+        std::copy(r.dy, r.dy + dimension, dy + i * dimension);
+    }
+
+    delete[] m_slab;
+    m_slab      = slab;
+    m_x         = x;
+    m_y         = y;
+    m_dy        = dy;
+    m_capacity  = capacity;
+    m_dimension = dimension;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(keep, std::memory_order_relaxed);
+    m_tailCache = keep;
+    m_headCache = 0;
+    for (size_t i = 0; i < MAX_READERS; ++i)
+        m_readers[i].head.store(0, std::memory_order_relaxed);
+}
+
+// Only called by the producer, which wrote all points in [head, tail).
+template <typename T>
+inline bool
+Trajectory<T>::spansHorizon(size_t head, size_t tail) const
+{
+    return m_horizon > 0 && tail != head
+        && *row(tail - 1).x - *row(head).x >= m_horizon;
+}
+
+// The head of the primary consumer or of the lossless reader furthest
+// behind.
+template <typename T>
+inline size_t
+Trajectory<T>::slowestHead(size_t tail) const
+{
+    size_t head = m_head.load(std::memory_order_acquire);
+    for (size_t i = 0; i < MAX_READERS; ++i)
+    {
+        Cursor const& c = m_readers[i];
+        if (c.mode.load(std::memory_order_acquire) != LOSSLESS) continue;
+        size_t const h = c.head.load(std::memory_order_acquire);
+        if (tail - h > tail - head) head = h;
+    }
+    return head;
+}
+
+// Reader ids start at 1, leaving 0 for the primary consumer.
+template <typename T>
+inline size_t
+Trajectory<T>::readerIndex(int reader)
+{
+    if (reader < 1 || reader > static_cast<int>(MAX_READERS))
+        throw std::invalid_argument("Trajectory::readerIndex(): Invalid \
+reader.");
+    return static_cast<size_t>(reader - 1);
+}
+
+template <typename T>
+inline typename Trajectory<T>::Row
+Trajectory<T>::row(size_t index) const
+{
+    size_t const i = index % m_capacity;
+    Row const r = {
+        m_x + i,
+        m_y + i * m_dimension,
+        m_dy + i * m_dimension
+    };
+    return r;
+}
+
+} // namespace jg
+
+#endif // JG_TRAJECTORY_HPP